@@ -1,10 +1,13 @@
+import os
+import sys
+
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..'))
+import msa_trace
+
+
 def create_new_log(path1, path2):
-    file = open(f'{path1}/log_msa')
-    log_msa = list(file)[1:]
-    file.close()
-    file = open(f'{path2}/log_msa')
-    log_main = list(file)[1:]
-    file.close()
+    log_msa = list(msa_trace.lines(f'{path1}/log_msa'))[1:]
+    log_main = list(msa_trace.lines(f'{path2}/log_msa'))[1:]
 
     cnt_from_start = 0
     cnt_from_end = 0
@@ -0,0 +1,54 @@
+# -*- coding: utf-8 -*-
+# Файлы метрик из JSON-сводки, которую qemu-mips64el пишет при запуске с
+# ключом -msa-metrics (target/mips/msa_metrics.c), без разбора лога.
+#
+# Использование: json_metrics.py <сводка.json> <папка для метрик>
+import json
+import os
+import sys
+
+if len(sys.argv) != 3:
+    print('Использование: json_metrics.py <сводка.json> <папка для метрик>')
+    sys.exit(1)
+
+path_to_json = sys.argv[1]
+path_to_metrics = sys.argv[2]
+
+with open(path_to_json) as f:
+    summary = json.load(f)
+
+if not os.path.exists(path_to_metrics):
+    os.mkdir(path_to_metrics)
+
+out = open(path_to_metrics + '/msa_metric', 'w')
+if summary['msa_ldst'] != 0:
+    out.write('Среднее число векторных операций на один доступ к данным: ' + str(summary['msa_ops']/summary['msa_ldst']))
+out.close()
+
+out = open(path_to_metrics + '/data_alignment_metric', 'w')
+out.write('Выравнивание данных: \n')
+out.write('Количество обращений к выравненным адресам: ' + str(summary['aligned16']) + '\n')
+out.write('Количество обращений к невыравненным адресам: ' + str(summary['unaligned16']) + '\n')
+if summary['unaligned16'] != 0:
+    out.write('Отношение количества обращений к выраненным адресам к количеству обращений к невыравненным адресам: ' + str(summary['aligned16']/summary['unaligned16']))
+out.close()
+
+out = open(path_to_metrics + '/space_localization_metric', 'w')
+out.write('Пространственная локализация данных: суммарное кол-во обращений по одному блоку (32 байта)/ Количество команд чтения и записи\n')
+out.write('Номер блока: Результат\n')
+for block, cnt in summary['blocks32']:
+    out.write(str(block) + ': ' + str(cnt/summary['accesses']) + '\n')
+out.close()
+
+# Вместо time_localization_metric: гистограмма расстояний повторного
+# использования (число различных адресов между двумя обращениями к X)
+out = open(path_to_metrics + '/reuse_distance_metric', 'w')
+out.write('Расстояние повторного использования: число различных адресов между двумя соседними обращениями к одному адресу.\n')
+out.write('Первых обращений: ' + str(summary['reuse_cold']) + '\n')
+out.write('Расстояние: Количество обращений\n')
+for i, cnt in enumerate(summary['reuse_log2']):
+    if i == 0:
+        out.write('0: ' + str(cnt) + '\n')
+    else:
+        out.write(str(2**(i-1)) + '-' + str(2**i - 1) + ': ' + str(cnt) + '\n')
+out.close()
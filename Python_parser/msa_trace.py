@@ -0,0 +1,84 @@
+# -*- coding: utf-8 -*-
+# Чтение бинарного лога, который пишет qemu-mips64el (target/mips/msa_trace.h).
+# Файл отображается в память целиком и разбирается по записям фиксированного
+# размера, без построчного чтения.
+#
+# Каждая запись - одно обращение к памяти во время исполнения: 64-битное
+# слово, в старших 16 битах которого номер места (site) команды
+# чтения/записи, а в младших 48 - виртуальный адрес гостя.
+import mmap
+import struct
+
+MAGIC = b'MSATRACE'
+VERSION = 3
+
+HEADER = struct.Struct('=8sIIIIQQIIQI4x')
+OPCODE = struct.Struct('=24sBB6xQ')
+SITE = struct.Struct('=QH6x')
+RECORD = struct.Struct('=Q')
+
+ADDR_BITS = 48
+ADDR_MASK = (1 << ADDR_BITS) - 1
+
+F_MSA = 0x01
+F_LOAD = 0x02
+F_STORE = 0x04
+F_LDST = F_LOAD | F_STORE
+
+
+class Trace:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        (magic, version, header_size, record_size, opcode_size,
+         self.nr_records, opcodes_offset, nr_opcodes,
+         site_size, sites_offset, nr_sites) = HEADER.unpack_from(self.data, 0)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(path + ': не является логом MSA (версия %d)' % VERSION)
+        if (record_size != RECORD.size or opcode_size != OPCODE.size or
+                site_size != SITE.size):
+            raise ValueError(path + ': неподдерживаемый размер записи')
+        if opcodes_offset == 0:
+            raise ValueError(path + ': лог не закрыт, таблица команд отсутствует')
+        self.header_size = header_size
+        self.opcodes = []
+        for i in range(nr_opcodes):
+            name, flags, size, count = OPCODE.unpack_from(self.data, opcodes_offset + i * OPCODE.size)
+            self.opcodes.append((name.rstrip(b'\0').decode(), flags, size, count))
+        self.sites = []
+        for i in range(nr_sites):
+            self.sites.append(SITE.unpack_from(self.data, sites_offset + i * SITE.size))
+
+    def __len__(self):
+        return self.nr_records
+
+    def __iter__(self):
+        """(имя команды, флаги, размер доступа, pc, адрес) для каждой записи"""
+        opcodes = self.opcodes
+        sites = self.sites
+        end = self.header_size + self.nr_records * RECORD.size
+        for rec, in RECORD.iter_unpack(memoryview(self.data)[self.header_size:end]):
+            pc, opc = sites[rec >> ADDR_BITS]
+            name, flags, size, count = opcodes[opc]
+            yield name, flags, size, pc, rec & ADDR_MASK
+
+
+def msa_counts(path):
+    """Число исполненных векторных команд и векторных обращений к памяти."""
+    acc_msa = 0
+    acc_msaldst = 0
+    for name, flags, size, count in Trace(path).opcodes:
+        if flags & F_MSA:
+            # По флагам, а не по имени: LDI, SLD и SLDI не обращаются к памяти
+            if flags & F_LDST:
+                acc_msaldst += count
+            else:
+                acc_msa += count
+    return acc_msa, acc_msaldst
+
+
+def lines(path):
+    """Обращения к памяти в старом текстовом формате: 'MSA:' и затем 'LW    0x830'."""
+    yield 'MSA:\n'
+    for name, flags, size, pc, addr in Trace(path):
+        yield '%s    0x%x\n' % (name, addr)
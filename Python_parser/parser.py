@@ -1,5 +1,6 @@
 # -*- coding: utf-8 -*-
 import collections as col
+import msa_trace
 
 def find_2nd(string, substring):
    return string.find(substring, string.find(substring) + 1)
@@ -7,9 +8,9 @@ def find_2nd(string, substring):
 common = {}
 msa = {}
 address = col.defaultdict(dict)
-f = open('log_msa')
+f = msa_trace.lines('log_msa')
 cnt = -1
-for line in f.readlines():
+for line in f:
     cnt +=1
     command = line[:line.find(" ")]
     indx = line.find("0")
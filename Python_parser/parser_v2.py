@@ -2,6 +2,7 @@
 import collections as col
 import sys
 import os
+import msa_trace
 
 only_main = False
 
@@ -29,11 +30,17 @@ elif len(sys.argv) == 5:
     path_to_metrics += name_of_metrics_folder
     only_main = True
 
+main_msa = 0
+main_msaldst = 0
 if only_main == True:
     main_cnt = -1
 else:
     file = open(path_to_metrics + '/main_cnt', 'r')
     main_cnt = int(file.readline())
+    # Вторая строка (если есть): исполненные векторные команды пустого main
+    main_dyn = file.readline().split()
+    if len(main_dyn) == 2:
+        main_msa, main_msaldst = int(main_dyn[0]), int(main_dyn[1])
     
 if not os.path.exists(path_to_metrics):
     os.mkdir(path_to_metrics)
@@ -42,7 +49,7 @@ else:
     print('Directory', path_to_metrics, 'already exists')
     
 if os.path.exists(path_to_log):
-    f = open(path_to_log)    
+    f = msa_trace.lines(path_to_log)
     print('Log file loaded')    
 else:
     print('Log file was not loaded')
@@ -65,7 +72,7 @@ ldst_list = ['LB', 'LBU', 'LWU', 'LD', 'LLD', 'LDL', 'LDR', 'LDPC', 'LWPC', 'LWE
              'SDC1', 'MSA_LD_B', 'MSA_LD_H', 'MSA_LD_W', 'MSA_LD_D', 'MSA_ST_B', 'MSA_ST_H', 'MSA_ST_W',
              'MSA_ST_D']
 
-for line in f.readlines():
+for line in f:
     if only_main == True:
         main_cnt += 1
     else:
@@ -127,20 +134,17 @@ for line in f.readlines():
                         msa[command] += 1
                 else:
                     common[command] += 1
+# Число векторных команд берется из счетчиков исполнения, а не из записей
+# лога: запись делается один раз при трансляции блока, даже если он
+# исполняется в цикле.
+acc_msa, acc_msaldst = msa_trace.msa_counts(path_to_log)
 if only_main == True:
     out = open(path_to_metrics + '/main_cnt', 'w')    
-    out.write(str(main_cnt))
+    out.write(str(main_cnt) + '\n' + str(acc_msa) + ' ' + str(acc_msaldst))
 else:
     out = open(path_to_metrics + '/msa_metric', 'w')
-    acc_common = 0
-    acc_msa = 0
-    acc_msaldst = 0
-    for k, v in msa.items():
-        acc_msa += v
-    for k, v in msaldst.items():
-        acc_msaldst += v
-    for k, v in common.items():
-        acc_common += v
+    acc_msa -= main_msa
+    acc_msaldst -= main_msaldst
     if acc_msaldst != 0:
         out.write('Среднее число векторных операций на один доступ к данным: ' + str((acc_msa)/(acc_msaldst)))
     out.close()
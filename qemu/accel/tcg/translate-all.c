@@ -53,6 +53,9 @@
 #include "exec/tb-hash.h"
 #include "translate-all.h"
 #include "qemu/bitmap.h"
+#if defined(CONFIG_USER_ONLY) && defined(CONFIG_CPUID_H)
+#include "qemu/cpuid.h"
+#endif
 #include "qemu/error-report.h"
 #include "qemu/timer.h"
 #include "qemu/main-loop.h"
@@ -76,6 +79,16 @@
 #define DEBUG_TB_FLUSH_GATE 0
 #endif
 
+#ifdef CONFIG_USER_ONLY
+/* Persistent translation cache, see tb_cache_init() */
+static struct {
+    char *filename;
+    bool active;                /* tb_cache_init() was called */
+    uint64_t key;
+    TBCacheSaveFn *save_extra;
+} tb_cache;
+#endif
+
 #if !defined(CONFIG_USER_ONLY)
 /* TB consistency checks only implemented for usermode emulation.  */
 #undef DEBUG_TB_CHECK
@@ -1240,6 +1253,89 @@ static void tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
 #endif
 }
 
+/* Guest pcs translated so far, for the retranslation count */
+static GHashTable *tb_stats_pcs;
+static char *tb_stats_file;
+
+/* Start counting the execution statistics, reported to @filename at
+ * exit by tb_stats_report(); "-" is stderr.
+ */
+void tb_stats_enable(const char *filename)
+{
+    g_free(tb_stats_file);
+    tb_stats_file = g_strdup(filename);
+    if (!tb_stats_pcs) {
+        tb_stats_pcs = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                             g_free, NULL);
+    }
+    tb_ctx.stats_enabled = true;
+}
+
+/* Called with tb_lock held */
+static void tb_stats_translated(TranslationBlock *tb)
+{
+    int64_t *pc = g_new(int64_t, 1);
+
+    *pc = tb->pc;
+    tb_ctx.tb_gen_count++;
+    if (g_hash_table_lookup_extended(tb_stats_pcs, pc, NULL, NULL)) {
+        tb_ctx.tb_retranslate_count++;
+        g_free(pc);
+    } else {
+        g_hash_table_insert(tb_stats_pcs, pc, NULL);
+    }
+}
+
+static double tb_stats_pct(size_t part, size_t total)
+{
+    return total ? 100.0 * part / total : 0;
+}
+
+void tb_stats_report(void)
+{
+    size_t lookups, entries;
+    FILE *f;
+
+    if (!tb_ctx.stats_enabled) {
+        return;
+    }
+    if (strcmp(tb_stats_file, "-") == 0) {
+        f = stderr;
+    } else {
+        f = fopen(tb_stats_file, "w");
+        if (!f) {
+            error_report("tb-stats: cannot open '%s': %s", tb_stats_file,
+                         strerror(errno));
+            return;
+        }
+    }
+
+    tb_lock();
+    entries = atomic_read(&tb_ctx.tb_exec_count);
+    lookups = atomic_read(&tb_ctx.lookup_ptr_count);
+    fprintf(f, "TB count              %d\n", g_tree_nnodes(tb_ctx.tb_tree));
+    fprintf(f, "translations          %zu\n", tb_ctx.tb_gen_count);
+    fprintf(f, "retranslations        %zu\n", tb_ctx.tb_retranslate_count);
+    fprintf(f, "TB flush count        %u\n",
+            atomic_read(&tb_ctx.tb_flush_count));
+    fprintf(f, "TB invalidate count   %d\n", tb_ctx.tb_phys_invalidate_count);
+    fprintf(f, "chained jumps         %zu\n",
+            atomic_read(&tb_ctx.chain_count));
+    fprintf(f, "main loop entries     %zu\n", entries);
+    fprintf(f, "goto_ptr lookups      %zu (%.1f%% to main loop)\n", lookups,
+            tb_stats_pct(atomic_read(&tb_ctx.lookup_ptr_miss_count),
+                         lookups));
+    fprintf(f, "tb_jmp_cache misses   %zu\n",
+            atomic_read(&tb_ctx.jmp_cache_miss_count));
+    fprintf(f, "tb_htable misses      %zu\n",
+            atomic_read(&tb_ctx.htable_miss_count));
+    tb_unlock();
+
+    if (f != stderr) {
+        fclose(f);
+    }
+}
+
 /* Called with mmap_lock held for user mode emulation.  */
 TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
@@ -1396,6 +1492,9 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
      */
     tb_link_page(tb, phys_pc, phys_page2);
     g_tree_insert(tb_ctx.tb_tree, &tb->tc, tb);
+    if (unlikely(tb_ctx.stats_enabled)) {
+        tb_stats_translated(tb);
+    }
     return tb;
 }
 
@@ -2211,6 +2310,358 @@ int page_unprotect(target_ulong address, uintptr_t pc)
     mmap_unlock();
     return 0;
 }
+
+/*
+ * Persistent translation cache.
+ *
+ * The code buffer is saved to a file at exit together with the list of
+ * valid TBs, and mapped back at the same host address by the next run,
+ * before the guest starts.  Translated code refers to helpers, to the
+ * prologue and to other TBs (which live in the code buffer) by absolute
+ * or PC-relative address, and to the CPU state relative to env, so the
+ * code is reusable as long as the QEMU binary, its load address, the
+ * code buffer address, guest_base and the host CPU features the backend
+ * picked instructions by are the same; all of them are part of the host
+ * key.  The caller's key covers the guest binary, the CPU model and
+ * anything else that changes the generated code.
+ *
+ * Nothing is relocated.  linux-user uses a static code buffer, so both
+ * the helpers and the buffer only stay at the same address across runs
+ * in a position-dependent build: a PIE binary is loaded at a random
+ * address and would never hit the cache, so the caller refuses -tb-cache
+ * there (see tb_cache_setup() in linux-user/main.c).
+ *
+ * Every TB also records a hash of its guest code and is only relinked
+ * if the guest bytes still match, so a stale or foreign cache can cost
+ * a translation but never run the wrong code.
+ */
+#define TB_CACHE_MAGIC      "QEMUTBC1"
+
+typedef struct TBCacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint64_t host_key;
+    uint64_t buffer;            /* host address of the code buffer */
+    uint64_t region;            /* start of the TBs, after the prologue */
+    uint64_t code_offset;       /* file offset of the code, page aligned */
+    uint64_t code_size;
+    uint64_t tbs_offset;
+    uint64_t nr_tbs;
+    uint64_t extra_offset;
+    uint64_t extra_size;
+} TBCacheHeader;
+
+typedef struct TBCacheEntry {
+    uint64_t offset;            /* of the TranslationBlock in the buffer */
+    uint64_t hash;              /* of its guest code */
+} TBCacheEntry;
+
+uint64_t tb_cache_hash(uint64_t h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    size_t i;
+
+    /* FNV-1a */
+    for (i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+/*
+ * The TCG backend emits optional instructions (MOVBE, BMI, LZCNT, ...)
+ * when cpuid reports them, so a cache saved on one host must not be
+ * loaded on another one with fewer features.
+ */
+static uint64_t tb_cache_hash_host_cpu(uint64_t h)
+{
+#ifdef CONFIG_CPUID_H
+    unsigned a, b, c, d;
+    uint32_t features[6] = { 0 };
+
+    if (__get_cpuid_max(0, 0) >= 1) {
+        __cpuid(1, a, b, c, d);
+        features[0] = c;
+        features[1] = d;
+    }
+    if (__get_cpuid_max(0, 0) >= 7) {
+        __cpuid_count(7, 0, a, b, c, d);
+        features[2] = b;
+        features[3] = c;
+    }
+    if (__get_cpuid_max(0x80000000, 0) >= 0x80000001) {
+        __cpuid(0x80000001, a, b, c, d);
+        features[4] = c;
+        features[5] = d;
+    }
+    h = tb_cache_hash(h, features, sizeof(features));
+#endif
+    return h;
+}
+
+static uint64_t tb_cache_host_key(void)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    uintptr_t addr = (uintptr_t)tb_gen_code;
+    struct stat st;
+
+    memset(&st, 0, sizeof(st));
+    stat("/proc/self/exe", &st);
+    h = tb_cache_hash(h, &st.st_ino, sizeof(st.st_ino));
+    h = tb_cache_hash(h, &st.st_size, sizeof(st.st_size));
+    h = tb_cache_hash(h, &st.st_mtime, sizeof(st.st_mtime));
+    h = tb_cache_hash(h, &addr, sizeof(addr));
+    h = tb_cache_hash(h, &guest_base, sizeof(guest_base));
+    h = tb_cache_hash_host_cpu(h);
+    return tb_cache_hash(h, TARGET_NAME, strlen(TARGET_NAME));
+}
+
+/* Hash of the guest code of @tb, 0 if it is no longer mapped */
+static uint64_t tb_cache_guest_hash(TranslationBlock *tb)
+{
+    if (tb->size == 0 || page_check_range(tb->pc, tb->size, PAGE_READ)) {
+        return 0;
+    }
+    return tb_cache_hash(0xcbf29ce484222325ull ^ tb->flags,
+                         g2h(tb->pc), tb->size);
+}
+
+/* Relink the TBs of a loaded cache; called with mmap_lock and tb_lock */
+static size_t tb_cache_relink(void *buffer, size_t size,
+                              const TBCacheEntry *entries, uint64_t nr_tbs)
+{
+    CPUArchState *env = first_cpu->env_ptr;
+    size_t linked = 0;
+    uint64_t i;
+    int n;
+
+    for (i = 0; i < nr_tbs; i++) {
+        TranslationBlock *tb = buffer + entries[i].offset;
+        tb_page_addr_t phys_pc, phys_page2 = -1;
+        target_ulong virt_page2;
+
+        if (entries[i].offset > size - sizeof(*tb) ||
+            tb->tc.ptr < buffer || tb->tc.ptr + tb->tc.size > buffer + size ||
+            tb_cache_guest_hash(tb) != entries[i].hash) {
+            continue;
+        }
+        tb->orig_tb = NULL;
+        tb->jmp_list_first = (uintptr_t)tb | 2;
+        for (n = 0; n < 2; n++) {
+            tb->jmp_list_next[n] = (uintptr_t)NULL;
+            if (tb->jmp_reset_offset[n] != TB_JMP_RESET_OFFSET_INVALID) {
+                tb_reset_jump(tb, n);
+            }
+        }
+
+        phys_pc = get_page_addr_code(env, tb->pc);
+        virt_page2 = (tb->pc + tb->size - 1) & TARGET_PAGE_MASK;
+        if ((tb->pc & TARGET_PAGE_MASK) != virt_page2) {
+            phys_page2 = get_page_addr_code(env, virt_page2);
+        }
+        tb_link_page(tb, phys_pc, phys_page2);
+        g_tree_insert(tb_ctx.tb_tree, &tb->tc, tb);
+        linked++;
+    }
+    return linked;
+}
+
+static bool tb_cache_in_file(const struct stat *st, uint64_t offset,
+                             uint64_t size)
+{
+    uint64_t file_size = st->st_size;
+
+    return size <= file_size && offset <= file_size - size;
+}
+
+static void tb_cache_load(const char *filename, TBCacheLoadFn *load_extra)
+{
+    TCGContext *s = tcg_ctx;
+    TBCacheHeader hdr;
+    TBCacheEntry *entries = NULL;
+    void *extra = NULL;
+    struct stat st;
+    size_t len;
+    void *buf;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+        memcmp(hdr.magic, TB_CACHE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.key != tb_cache.key || hdr.host_key != tb_cache_host_key() ||
+        hdr.buffer != (uintptr_t)s->code_gen_prologue ||
+        hdr.region != (uintptr_t)s->code_gen_buffer ||
+        s->code_gen_ptr != s->code_gen_buffer ||
+        hdr.buffer + hdr.code_size > (uintptr_t)s->code_gen_highwater ||
+        hdr.nr_tbs > hdr.code_size / sizeof(TranslationBlock)) {
+        goto out;
+    }
+
+    /* Do not trust the sizes before allocating for them */
+    len = hdr.nr_tbs * sizeof(TBCacheEntry);
+    if (fstat(fd, &st) < 0 ||
+        !tb_cache_in_file(&st, hdr.tbs_offset, len) ||
+        !tb_cache_in_file(&st, hdr.extra_offset, hdr.extra_size) ||
+        !tb_cache_in_file(&st, hdr.code_offset, hdr.code_size)) {
+        goto out;
+    }
+    entries = g_malloc(len);
+    extra = g_malloc(hdr.extra_size);
+    if (pread(fd, entries, len, hdr.tbs_offset) != len ||
+        pread(fd, extra, hdr.extra_size, hdr.extra_offset) != hdr.extra_size) {
+        goto out;
+    }
+    if (load_extra && !load_extra(extra, hdr.extra_size)) {
+        goto out;
+    }
+
+    /* Map the code over the buffer, pages are only read when used */
+    len = REAL_HOST_PAGE_ALIGN(hdr.code_size);
+    buf = mmap(s->code_gen_prologue, len, PROT_READ | PROT_WRITE | PROT_EXEC,
+               MAP_PRIVATE | MAP_FIXED, fd, hdr.code_offset);
+    if (buf == MAP_FAILED) {
+        if (pread(fd, s->code_gen_prologue, hdr.code_size,
+                  hdr.code_offset) != hdr.code_size) {
+            /* The prologue may be clobbered: give up */
+            error_report("tb-cache: cannot read '%s'", filename);
+            exit(1);
+        }
+    }
+    flush_icache_range(hdr.buffer, hdr.buffer + hdr.code_size);
+
+    mmap_lock();
+    tb_lock();
+    tb_cache_relink(s->code_gen_prologue, hdr.code_size, entries,
+                    hdr.nr_tbs);
+    atomic_set(&s->code_gen_ptr, s->code_gen_prologue + hdr.code_size);
+    tb_unlock();
+    mmap_unlock();
+
+out:
+    g_free(entries);
+    g_free(extra);
+    close(fd);
+}
+
+/* Use @filename as the persistent translation cache */
+void tb_cache_enable(const char *filename)
+{
+    g_free(tb_cache.filename);
+    tb_cache.filename = g_strdup(filename);
+}
+
+bool tb_cache_enabled(void)
+{
+    return tb_cache.filename != NULL;
+}
+
+/*
+ * Load the cache if it holds code for @key, and save it again at exit
+ * from tb_cache_save().  Call after tcg_region_init(), once the guest
+ * is loaded and before it runs.  The target may store extra data with
+ * the code, such as the instrumentation tables the code refers to.
+ */
+void tb_cache_init(uint64_t key, TBCacheLoadFn *load_extra,
+                   TBCacheSaveFn *save_extra)
+{
+    tb_cache.active = true;
+    tb_cache.key = key;
+    tb_cache.save_extra = save_extra;
+    tb_cache_load(tb_cache.filename, load_extra);
+}
+
+struct tb_cache_save_data {
+    GArray *entries;
+    void *buffer;
+};
+
+static gboolean tb_cache_save_iter(gpointer key, gpointer value,
+                                   gpointer data)
+{
+    struct tb_cache_save_data *d = data;
+    TranslationBlock *tb = value;
+    TBCacheEntry e;
+
+    if (!(tb->cflags & (CF_INVALID | CF_NOCACHE))) {
+        e.offset = (void *)tb - d->buffer;
+        e.hash = tb_cache_guest_hash(tb);
+        if (e.hash) {
+            g_array_append_val(d->entries, e);
+        }
+    }
+    return false;
+}
+
+static bool tb_cache_write(FILE *f, uint64_t offset, const void *data,
+                           size_t len)
+{
+    return fseeko(f, offset, SEEK_SET) == 0 &&
+           fwrite(data, 1, len, f) == len;
+}
+
+void tb_cache_save(void)
+{
+    TCGContext *s = tcg_ctx;
+    struct tb_cache_save_data d;
+    GByteArray *extra;
+    TBCacheHeader hdr;
+    char *tmp;
+    FILE *f;
+    bool ok;
+
+    if (!tb_cache.active) {
+        return;
+    }
+
+    tb_lock();
+    d.entries = g_array_new(false, false, sizeof(TBCacheEntry));
+    d.buffer = s->code_gen_prologue;
+    g_tree_foreach(tb_ctx.tb_tree, tb_cache_save_iter, &d);
+    extra = g_byte_array_new();
+    if (tb_cache.save_extra) {
+        tb_cache.save_extra(extra);
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TB_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.key = tb_cache.key;
+    hdr.host_key = tb_cache_host_key();
+    hdr.buffer = (uintptr_t)s->code_gen_prologue;
+    hdr.region = (uintptr_t)s->code_gen_buffer;
+    hdr.code_size = s->code_gen_ptr - s->code_gen_prologue;
+    hdr.nr_tbs = d.entries->len;
+    hdr.tbs_offset = sizeof(hdr);
+    hdr.extra_offset = hdr.tbs_offset + hdr.nr_tbs * sizeof(TBCacheEntry);
+    hdr.extra_size = extra->len;
+    hdr.code_offset = REAL_HOST_PAGE_ALIGN(hdr.extra_offset + extra->len);
+
+    /* Concurrent runs may share the cache: replace it atomically */
+    tmp = g_strdup_printf("%s.%d", tb_cache.filename, getpid());
+    f = fopen(tmp, "wb");
+    ok = f &&
+         tb_cache_write(f, 0, &hdr, sizeof(hdr)) &&
+         tb_cache_write(f, hdr.tbs_offset, d.entries->data,
+                        hdr.nr_tbs * sizeof(TBCacheEntry)) &&
+         tb_cache_write(f, hdr.extra_offset, extra->data, extra->len) &&
+         tb_cache_write(f, hdr.code_offset, s->code_gen_prologue,
+                        hdr.code_size);
+    if (f && fclose(f)) {
+        ok = false;
+    }
+    if (!ok || rename(tmp, tb_cache.filename)) {
+        error_report("tb-cache: cannot write '%s': %s", tb_cache.filename,
+                     strerror(errno));
+        unlink(tmp);
+    }
+    tb_unlock();
+
+    g_free(tmp);
+    g_array_free(d.entries, true);
+    g_byte_array_free(extra, true);
+}
 #endif /* CONFIG_USER_ONLY */
 
 /* This is a wrapper for common code that can not use CONFIG_SOFTMMU */
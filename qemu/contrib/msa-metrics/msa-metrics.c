@@ -0,0 +1,431 @@
+/*
+ * msa-metrics: memory access metrics of a qemu-mips64el MSA trace
+ *
+ * A single streaming pass over the binary trace written by -msa-trace
+ * (see target/mips/msa_trace.h) that produces the same metric files,
+ * byte for byte, as Python_parser/parser_v2.py:
+ *
+ *   msa_metric, time_localization_metric, data_alignment_metric and
+ *   space_localization_metric in the metrics directory, or main_cnt when
+ *   run on the trace of an empty main().
+ *
+ * The command line is that of parser_v2.py:
+ *
+ *   msa-metrics [log [dir [name [main]]]]
+ *
+ * Copyright (c) 2026 dan4ezz
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu-common.h"
+#include <sys/mman.h>
+
+#include "target/mips/msa_trace.h"
+
+#define ALIGN_BYTES     16
+#define BLOCK_SHIFT     5
+
+/* Opcodes parser_v2.py counts as loads and stores */
+static const char *const ldst_list[] = {
+    "LB", "LBU", "LWU", "LD", "LLD", "LDL", "LDR", "LDPC", "LWPC", "LWE",
+    "LW", "LHE", "LH", "LHUE", "LHU", "LBE", "LBUE", "LWLE", "LWL", "LWRE",
+    "LWR", "LLE", "LL", "SD", "SDL", "SDR", "SWE", "SW", "SHE", "SH", "SBE",
+    "SB", "SWLE", "SWL", "SWRE", "SWR", "SCD", "SCE", "SC", "LWC1", "SWC1",
+    "LDC1", "SDC1", "MSA_LD_B", "MSA_LD_H", "MSA_LD_W", "MSA_LD_D",
+    "MSA_ST_B", "MSA_ST_H", "MSA_ST_W", "MSA_ST_D",
+};
+
+/* Open addressing hash map from an address to an index */
+typedef struct AddrMap {
+    uint64_t *keys;             /* key + 1, 0 marks a free slot */
+    size_t *vals;
+    unsigned bits;
+    size_t used;
+} AddrMap;
+
+/* First access to an address, in the order addresses are first seen */
+typedef struct AddrInfo {
+    uint64_t addr;
+    uint64_t first;             /* time of the first access */
+    uint64_t reuse;             /* accesses until the first reuse, or 0 */
+} AddrInfo;
+
+typedef struct Block {
+    uint64_t block;
+    uint64_t count;
+} Block;
+
+static void addr_map_init(AddrMap *map, unsigned bits)
+{
+    map->bits = bits;
+    map->used = 0;
+    map->keys = g_new0(uint64_t, 1ULL << bits);
+    map->vals = g_new0(size_t, 1ULL << bits);
+}
+
+/*
+ * Return the index slot of @key, inserting it if absent; *@found tells
+ * which.  The slot stays valid until the next insertion.
+ */
+static size_t *addr_map_get(AddrMap *map, uint64_t key, bool *found)
+{
+    size_t mask = (1ULL << map->bits) - 1;
+    size_t i;
+
+    if (map->used * 2 >= mask) {
+        AddrMap old = *map;
+
+        addr_map_init(map, old.bits + 1);
+        for (i = 0; i <= mask; i++) {
+            if (old.keys[i]) {
+                *addr_map_get(map, old.keys[i] - 1, found) = old.vals[i];
+            }
+        }
+        g_free(old.keys);
+        g_free(old.vals);
+        mask = (1ULL << map->bits) - 1;
+    }
+
+    for (i = (key * 0x9e3779b97f4a7c15ULL) >> (64 - map->bits); ;
+         i = (i + 1) & mask) {
+        if (map->keys[i] == key + 1) {
+            *found = true;
+            return &map->vals[i];
+        }
+        if (!map->keys[i]) {
+            map->keys[i] = key + 1;
+            map->used++;
+            *found = false;
+            return &map->vals[i];
+        }
+    }
+}
+
+/* Format @v like Python's str(float) */
+static void format_float(GString *out, double v)
+{
+    char buf[32], digits[32];
+    int prec, exp, ndigits, i;
+    char *p;
+
+    if (!isfinite(v)) {
+        g_string_append(out, isnan(v) ? "nan" : v < 0 ? "-inf" : "inf");
+        return;
+    }
+
+    /* Shortest representation that reads back as the same double */
+    for (prec = 0; prec < 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*e", prec, v);
+        if (strtod(buf, NULL) == v) {
+            break;
+        }
+    }
+    if (buf[0] == '-') {
+        g_string_append_c(out, '-');
+        memmove(buf, buf + 1, strlen(buf));
+    }
+    p = strchr(buf, 'e');
+    exp = atoi(p + 1);
+    for (ndigits = 0, i = 0; buf + i < p; i++) {
+        if (buf[i] != '.') {
+            digits[ndigits++] = buf[i];
+        }
+    }
+    while (ndigits > 1 && digits[ndigits - 1] == '0') {
+        ndigits--;
+    }
+    digits[ndigits] = '\0';
+
+    if (exp < -4 || exp >= 16) {
+        g_string_append_c(out, digits[0]);
+        if (ndigits > 1) {
+            g_string_append_printf(out, ".%s", digits + 1);
+        }
+        g_string_append_printf(out, "e%c%02d", exp < 0 ? '-' : '+', abs(exp));
+    } else if (exp < 0) {
+        g_string_append(out, "0.");
+        for (i = -1; i > exp; i--) {
+            g_string_append_c(out, '0');
+        }
+        g_string_append(out, digits);
+    } else if (exp + 1 >= ndigits) {
+        g_string_append(out, digits);
+        for (i = ndigits; i < exp + 1; i++) {
+            g_string_append_c(out, '0');
+        }
+        g_string_append(out, ".0");
+    } else {
+        g_string_append_len(out, digits, exp + 1);
+        g_string_append_printf(out, ".%s", digits + exp + 1);
+    }
+}
+
+static void write_file(const char *dir, const char *name, GString *s)
+{
+    char *path = g_strdup_printf("%s/%s", dir, name);
+    GError *err = NULL;
+
+    if (!g_file_set_contents(path, s->str, s->len, &err)) {
+        fprintf(stderr, "msa-metrics: %s\n", err->message);
+        exit(EXIT_FAILURE);
+    }
+    g_free(path);
+}
+
+static int cmp_block(const void *a, const void *b)
+{
+    uint64_t x = ((const Block *)a)->block;
+    uint64_t y = ((const Block *)b)->block;
+
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path_to_log = "./log_msa";
+    char *path_to_metrics;
+    bool only_main = argc == 5;
+    int64_t main_cnt = -1;
+    uint64_t main_msa = 0, main_msaldst = 0;
+    uint64_t acc_msa = 0, acc_msaldst = 0;
+    const MSATraceHeader *hdr;
+    const MSATraceOpcode *opcodes;
+    const MSATraceSite *sites;
+    const uint64_t *records;
+    bool *site_ldst;
+    uint8_t *map;
+    struct stat st;
+    AddrMap addrs, blocks;
+    GArray *infos, *block_counts;
+    uint64_t ldst_cnt = 0, aligned = 0, unaligned = 0;
+    uint64_t i, n, skip;
+    GString *out;
+    size_t j;
+    int fd;
+
+    switch (argc) {
+    case 1:
+        path_to_metrics = g_strdup("./metrics");
+        break;
+    case 2:
+        path_to_log = argv[1];
+        path_to_metrics = g_strdup("./metrics");
+        break;
+    case 3:
+        path_to_log = argv[1];
+        path_to_metrics = g_strdup_printf("%s/metrics", argv[2]);
+        break;
+    case 4:
+    case 5:
+        path_to_log = argv[1];
+        path_to_metrics = g_strdup_printf("%s/%s", argv[2], argv[3]);
+        break;
+    default:
+        fprintf(stderr, "usage: %s [log [dir [name [main]]]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!only_main) {
+        char *path = g_strdup_printf("%s/main_cnt", path_to_metrics);
+        char *contents;
+        char **lines;
+
+        if (!g_file_get_contents(path, &contents, NULL, NULL)) {
+            fprintf(stderr, "msa-metrics: cannot read %s\n", path);
+            return EXIT_FAILURE;
+        }
+        lines = g_strsplit(contents, "\n", 3);
+        main_cnt = g_ascii_strtoll(lines[0], NULL, 10);
+        if (lines[1]) {
+            sscanf(lines[1], "%" SCNu64 " %" SCNu64, &main_msa, &main_msaldst);
+        }
+        g_strfreev(lines);
+        g_free(contents);
+        g_free(path);
+    }
+
+    if (mkdir(path_to_metrics, 0777) == 0) {
+        printf("Directory %s created\n", path_to_metrics);
+    } else {
+        printf("Directory %s already exists\n", path_to_metrics);
+    }
+
+    fd = open(path_to_log, O_RDONLY);
+    if (fd < 0) {
+        printf("Log file was not loaded\n");
+        return EXIT_SUCCESS;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(MSATraceHeader)) {
+        fprintf(stderr, "msa-metrics: %s: truncated trace\n", path_to_log);
+        return EXIT_FAILURE;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "msa-metrics: %s: %s\n", path_to_log, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    printf("Log file loaded\n");
+
+    hdr = (const MSATraceHeader *)map;
+    if (memcmp(hdr->magic, MSA_TRACE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != MSA_TRACE_VERSION ||
+        hdr->record_size != sizeof(uint64_t) ||
+        hdr->opcode_size != sizeof(MSATraceOpcode) ||
+        hdr->site_size != sizeof(MSATraceSite)) {
+        fprintf(stderr, "msa-metrics: %s: not an MSA trace (version %d)\n",
+                path_to_log, MSA_TRACE_VERSION);
+        return EXIT_FAILURE;
+    }
+    if (hdr->opcodes_offset == 0 ||
+        hdr->opcodes_offset + hdr->nr_opcodes * sizeof(MSATraceOpcode) >
+        st.st_size) {
+        fprintf(stderr, "msa-metrics: %s: trace was not closed\n",
+                path_to_log);
+        return EXIT_FAILURE;
+    }
+    records = (const uint64_t *)(map + hdr->header_size);
+    sites = (const MSATraceSite *)(map + hdr->sites_offset);
+    opcodes = (const MSATraceOpcode *)(map + hdr->opcodes_offset);
+    n = hdr->nr_records;
+
+    /* Vector operation counts come from the execution counters */
+    for (i = 0; i < hdr->nr_opcodes; i++) {
+        if (opcodes[i].flags & MSA_TRACE_F_MSA) {
+            if (opcodes[i].flags & MSA_TRACE_F_LDST) {
+                acc_msaldst += opcodes[i].count;
+            } else {
+                acc_msa += opcodes[i].count;
+            }
+        }
+    }
+
+    if (only_main) {
+        out = g_string_new(NULL);
+        g_string_printf(out, "%" PRIu64 "\n%" PRIu64 " %" PRIu64,
+                        n, acc_msa, acc_msaldst);
+        write_file(path_to_metrics, "main_cnt", out);
+        return EXIT_SUCCESS;
+    }
+
+    site_ldst = g_new0(bool, hdr->nr_sites);
+    for (i = 0; i < hdr->nr_sites; i++) {
+        const char *name = opcodes[sites[i].opc].name;
+
+        for (j = 0; j < ARRAY_SIZE(ldst_list); j++) {
+            if (!strcmp(name, ldst_list[j])) {
+                site_ldst[i] = true;
+                break;
+            }
+        }
+    }
+
+    /* The first main_cnt records belong to the empty program */
+    skip = MIN(main_cnt, n);
+    addr_map_init(&addrs, 16);
+    addr_map_init(&blocks, 16);
+    infos = g_array_new(false, false, sizeof(AddrInfo));
+    block_counts = g_array_new(false, false, sizeof(Block));
+    for (i = skip; i < n; i++) {
+        uint64_t rec = records[i];
+        uint64_t addr = MSA_TRACE_REC_ADDR(rec);
+        size_t *slot;
+        bool found;
+
+        if (site_ldst[MSA_TRACE_REC_SITE(rec)]) {
+            ldst_cnt++;
+        }
+
+        slot = addr_map_get(&addrs, addr, &found);
+        if (!found) {
+            AddrInfo info = { .addr = addr, .first = i };
+
+            *slot = infos->len;
+            g_array_append_val(infos, info);
+        } else {
+            AddrInfo *info = &g_array_index(infos, AddrInfo, *slot);
+
+            if (!info->reuse) {
+                info->reuse = i - info->first;
+            }
+        }
+
+        if (addr % ALIGN_BYTES == 0) {
+            aligned++;
+        } else {
+            unaligned++;
+        }
+
+        slot = addr_map_get(&blocks, addr >> BLOCK_SHIFT, &found);
+        if (!found) {
+            Block b = { .block = addr >> BLOCK_SHIFT };
+
+            *slot = block_counts->len;
+            g_array_append_val(block_counts, b);
+        }
+        g_array_index(block_counts, Block, *slot).count++;
+    }
+
+    out = g_string_new(NULL);
+    acc_msa -= main_msa;
+    acc_msaldst -= main_msaldst;
+    if (acc_msaldst != 0) {
+        g_string_append(out, "Среднее число векторных операций на один "
+                        "доступ к данным: ");
+        format_float(out, (double)(int64_t)acc_msa / (int64_t)acc_msaldst);
+    }
+    write_file(path_to_metrics, "msa_metric", out);
+
+    g_string_assign(out, "Временная локализация данных: количество "
+                    "уникальных адресов, которые запрашивается между двумя "
+                    "соседними запросами к адресу X, включая сам адрес X.\n");
+    for (j = 0; j < infos->len; j++) {
+        AddrInfo *info = &g_array_index(infos, AddrInfo, j);
+
+        g_string_append_printf(out, "0x%" PRIx64 ": %" PRIu64 "\n",
+                               info->addr, info->reuse ? info->reuse : 1);
+    }
+    write_file(path_to_metrics, "time_localization_metric", out);
+
+    g_string_assign(out, "Выравнивание данных: \n");
+    g_string_append_printf(out, "Количество обращений к выравненным "
+                           "адресам: %" PRIu64 "\n", aligned);
+    g_string_append_printf(out, "Количество обращений к невыравненным "
+                           "адресам: %" PRIu64 "\n", unaligned);
+    if (unaligned == 0) {
+        /* parser_v2.py stops here with ZeroDivisionError */
+        write_file(path_to_metrics, "data_alignment_metric", out);
+        fprintf(stderr, "msa-metrics: no unaligned accesses\n");
+        return EXIT_FAILURE;
+    }
+    g_string_append(out, "Отношение количества обращений к выраненным "
+                    "адресам к количеству обращений к невыравненным "
+                    "адресам: ");
+    format_float(out, (double)aligned / unaligned);
+    write_file(path_to_metrics, "data_alignment_metric", out);
+
+    g_string_assign(out, "Пространственная локализация данных: суммарное "
+                    "кол-во обращений по одному блоку (32 байта)/ Количество "
+                    "команд чтения и записи\n");
+    g_string_append(out, "Номер блока: Результат\n");
+    if (block_counts->len && ldst_cnt == 0) {
+        /* parser_v2.py stops here with ZeroDivisionError */
+        fprintf(stderr, "msa-metrics: no load/store records\n");
+        return EXIT_FAILURE;
+    }
+    g_array_sort(block_counts, cmp_block);
+    for (j = 0; j < block_counts->len; j++) {
+        Block *b = &g_array_index(block_counts, Block, j);
+
+        g_string_append_printf(out, "%" PRIu64 ": ", b->block);
+        format_float(out, (double)b->count / ldst_cnt);
+        g_string_append_c(out, '\n');
+    }
+    write_file(path_to_metrics, "space_localization_metric", out);
+
+    g_string_free(out, true);
+    return EXIT_SUCCESS;
+}
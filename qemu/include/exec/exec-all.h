@@ -403,6 +403,18 @@ static inline uint32_t curr_cflags(void)
 
 void tb_remove(TranslationBlock *tb);
 void tb_flush(CPUState *cpu);
+void tb_stats_enable(const char *filename);
+void tb_stats_report(void);
+#ifdef CONFIG_USER_ONLY
+typedef bool TBCacheLoadFn(const void *data, size_t size);
+typedef void TBCacheSaveFn(GByteArray *data);
+void tb_cache_enable(const char *filename);
+bool tb_cache_enabled(void);
+void tb_cache_init(uint64_t key, TBCacheLoadFn *load_extra,
+                   TBCacheSaveFn *save_extra);
+void tb_cache_save(void);
+uint64_t tb_cache_hash(uint64_t h, const void *data, size_t len);
+#endif
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, uint32_t flags,
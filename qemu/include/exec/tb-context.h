@@ -39,8 +39,26 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     int tb_phys_invalidate_count;
+
+    /* execution statistics, only counted after tb_stats_enable() */
+    bool stats_enabled;
+    size_t tb_exec_count;           /* TBs entered from the main loop */
+    size_t jmp_cache_miss_count;    /* tb_jmp_cache misses */
+    size_t htable_miss_count;       /* ... also missed in the htable */
+    size_t chain_count;             /* direct jumps patched */
+    size_t lookup_ptr_count;        /* indirect jumps looked up in TBs */
+    size_t lookup_ptr_miss_count;   /* ... that went to the main loop */
+    size_t tb_gen_count;            /* translations */
+    size_t tb_retranslate_count;    /* ... of an already translated pc */
 };
 
 extern TBContext tb_ctx;
 
+#define TB_STAT_INC(name)                               \
+    do {                                                \
+        if (unlikely(tb_ctx.stats_enabled)) {           \
+            atomic_inc(&tb_ctx.name);                   \
+        }                                               \
+    } while (0)
+
 #endif
@@ -38,8 +38,10 @@ tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
                (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
         return tb;
     }
+    TB_STAT_INC(jmp_cache_miss_count);
     tb = tb_htable_lookup(cpu, *pc, *cs_base, *flags, cf_mask);
     if (tb == NULL) {
+        TB_STAT_INC(htable_miss_count);
         return NULL;
     }
     atomic_set(&cpu->tb_jmp_cache[hash], tb);
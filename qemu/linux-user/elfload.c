@@ -1430,6 +1430,9 @@ static int elf_core_dump(int, const CPUArchState *);
 #endif /* USE_ELF_CORE_DUMP */
 static void load_symbols(struct elfhdr *hdr, int fd, abi_ulong load_bias);
 
+/* Load the symbol table even when logging is off */
+bool load_elf_symbols;
+
 /* Verify the portions of EHDR within E_IDENT for the target.
    This can be performed before bswapping the entire header.  */
 static bool elf_check_ident(struct elfhdr *ehdr)
@@ -1832,12 +1835,25 @@ static int validate_guest_space(unsigned long guest_base,
 }
 #endif
 
+/*
+ * Alignment of the guest space on the host.  Huge pages need guest and
+ * host addresses to agree modulo the huge page size.
+ */
+static unsigned long guest_space_align(void)
+{
+    if (guest_mem_flags & GUEST_MEM_HUGE) {
+        return MAX(qemu_host_page_size, GUEST_MEM_HUGE_SIZE);
+    }
+    return qemu_host_page_size;
+}
+
 unsigned long init_guest_space(unsigned long host_start,
                                unsigned long host_size,
                                unsigned long guest_start,
                                bool fixed)
 {
     unsigned long current_start, real_start;
+    unsigned long align = fixed ? qemu_host_page_size : guest_space_align();
     int flags;
 
     assert(host_start || host_size);
@@ -1853,7 +1869,7 @@ unsigned long init_guest_space(unsigned long host_start,
     }
 
     /* Setup the initial flags and start address.  */
-    current_start = host_start & qemu_host_page_mask;
+    current_start = QEMU_ALIGN_DOWN(host_start, align);
     flags = MAP_ANONYMOUS | MAP_PRIVATE | MAP_NORESERVE;
     if (fixed) {
         flags |= MAP_FIXED;
@@ -1875,15 +1891,15 @@ unsigned long init_guest_space(unsigned long host_start,
         }
 
         /* Ensure the address is properly aligned.  */
-        if (real_start & ~qemu_host_page_mask) {
+        if (real_start & (align - 1)) {
             munmap((void *)real_start, host_size);
-            real_size = host_size + qemu_host_page_size;
+            real_size = host_size + align;
             real_start = (unsigned long)
                 mmap((void *)real_start, real_size, PROT_NONE, flags, -1, 0);
             if (real_start == (unsigned long)-1) {
                 return (unsigned long)-1;
             }
-            real_start = HOST_PAGE_ALIGN(real_start);
+            real_start = QEMU_ALIGN_UP(real_start, align);
         }
 
         /* Check to see if the address is valid.  */
@@ -1908,8 +1924,8 @@ unsigned long init_guest_space(unsigned long host_start,
          * inconvenient.
          */
         munmap((void *)real_start, host_size);
-        current_start += qemu_host_page_size;
-        if (host_start == current_start) {
+        current_start += align;
+        if (QEMU_ALIGN_DOWN(host_start, align) == current_start) {
             /* Theoretically possible if host doesn't have any suitably
              * aligned areas.  Normally the first mmap will fail.
              */
@@ -1932,13 +1948,14 @@ static void probe_guest_base(const char *image_name,
     const char *errmsg;
     if (!have_guest_base && !reserved_va) {
         unsigned long host_start, real_start, host_size;
+        unsigned long align = guest_space_align();
 
         /* Round addresses to page boundaries.  */
-        loaddr &= qemu_host_page_mask;
+        loaddr = QEMU_ALIGN_DOWN(loaddr, align);
         hiaddr = HOST_PAGE_ALIGN(hiaddr);
 
         if (loaddr < mmap_min_addr) {
-            host_start = HOST_PAGE_ALIGN(mmap_min_addr);
+            host_start = QEMU_ALIGN_UP(mmap_min_addr, align);
         } else {
             host_start = loaddr;
             if (host_start != loaddr) {
@@ -2177,7 +2194,7 @@ static void load_elf_image(const char *image_name, int image_fd,
         info->brk = info->end_code;
     }
 
-    if (qemu_log_enabled()) {
+    if (qemu_log_enabled() || load_elf_symbols) {
         load_symbols(ehdr, image_fd, load_bias);
     }
 
@@ -2256,6 +2273,29 @@ static const char *lookup_symbolxx(struct syminfo *s, target_ulong orig_addr)
     return "";
 }
 
+/* Find the address of function NAME in the loaded symbol tables.  */
+bool lookup_symbol_addr(const char *name, abi_ulong *addr)
+{
+    struct syminfo *s;
+    unsigned int i;
+
+    for (s = syminfos; s; s = s->next) {
+#if ELF_CLASS == ELFCLASS32
+        struct elf_sym *syms = s->disas_symtab.elf32;
+#else
+        struct elf_sym *syms = s->disas_symtab.elf64;
+#endif
+
+        for (i = 0; i < s->disas_num_syms; i++) {
+            if (!strcmp(s->disas_strtab + syms[i].st_name, name)) {
+                *addr = syms[i].st_value;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 /* FIXME: This should use elf_ops.h  */
 static int symcmp(const void *s0, const void *s1)
 {
@@ -35,6 +35,9 @@
 #include "elf.h"
 #include "exec/log.h"
 #include "trace/control.h"
+#if defined(TARGET_MIPS)
+#include "target/mips/msa_trace.h"
+#endif
 
 char *exec_path;
 
@@ -44,6 +47,13 @@ static const char *argv0;
 static int gdbstub_port;
 static envlist_t *envlist;
 static const char *cpu_model;
+#if defined(TARGET_MIPS)
+static const char *msa_trace_file = "log_msa";
+static const char *msa_trace_roi;
+static const char *msa_metrics_file;
+static const char *msa_profile_file;
+static const char *msa_cache_arg;
+#endif
 unsigned long mmap_min_addr;
 unsigned long guest_base;
 int have_guest_base;
@@ -2155,55 +2165,6 @@ static const uint8_t mips_syscall_args[] = {
 #  undef MIPS_SYS
 # endif /* O32 */
 
-static int do_store_exclusive(CPUMIPSState *env)
-{
-    target_ulong addr;
-    target_ulong page_addr;
-    target_ulong val;
-    int flags;
-    int segv = 0;
-    int reg;
-    int d;
-
-    addr = env->lladdr;
-    page_addr = addr & TARGET_PAGE_MASK;
-    start_exclusive();
-    mmap_lock();
-    flags = page_get_flags(page_addr);
-    if ((flags & PAGE_READ) == 0) {
-        segv = 1;
-    } else {
-        reg = env->llreg & 0x1f;
-        d = (env->llreg & 0x20) != 0;
-        if (d) {
-            segv = get_user_s64(val, addr);
-        } else {
-            segv = get_user_s32(val, addr);
-        }
-        if (!segv) {
-            if (val != env->llval) {
-                env->active_tc.gpr[reg] = 0;
-            } else {
-                if (d) {
-                    segv = put_user_u64(env->llnewval, addr);
-                } else {
-                    segv = put_user_u32(env->llnewval, addr);
-                }
-                if (!segv) {
-                    env->active_tc.gpr[reg] = 1;
-                }
-            }
-        }
-    }
-    env->lladdr = -1;
-    if (!segv) {
-        env->active_tc.PC += 4;
-    }
-    mmap_unlock();
-    end_exclusive();
-    return segv;
-}
-
 /* Break codes */
 enum {
     BRK_OVERFLOW = 6,
@@ -2237,12 +2198,6 @@ static int do_break(CPUMIPSState *env, target_siginfo_t *info,
 
 void cpu_loop(CPUMIPSState *env)
 {
-	FILE* log_msa = fopen("log_msa", "w");
-	if(log_msa != 0) {
-		fprintf(log_msa, "MSA:\n");
-		fclose(log_msa);
-	}
-
     CPUState *cs = CPU(mips_env_get_cpu(env));
     target_siginfo_t info;
     int trapnr;
@@ -2359,15 +2314,6 @@ done_syscall:
                   }
             }
             break;
-        case EXCP_SC:
-            if (do_store_exclusive(env)) {
-                info.si_signo = TARGET_SIGSEGV;
-                info.si_errno = 0;
-                info.si_code = TARGET_SEGV_MAPERR;
-                info._sifields._sigfault._addr = env->active_tc.PC;
-                queue_signal(env, info.si_signo, QEMU_SI_FAULT, &info);
-            }
-            break;
         case EXCP_DSPDIS:
             info.si_signo = TARGET_SIGILL;
             info.si_errno = 0;
@@ -4037,6 +3983,25 @@ static void handle_arg_reserved_va(const char *arg)
     }
 }
 
+static void handle_arg_guest_mem(const char *arg)
+{
+    char **opts = g_strsplit(arg, ",", 0);
+    char **p;
+
+    for (p = opts; *p; p++) {
+        if (!strcmp(*p, "huge")) {
+            guest_mem_flags |= GUEST_MEM_HUGE;
+        } else if (!strcmp(*p, "populate")) {
+            guest_mem_flags |= GUEST_MEM_POPULATE;
+        } else {
+            fprintf(stderr, "-guest-mem: expected huge and/or populate, "
+                    "not '%s'\n", *p);
+            exit(EXIT_FAILURE);
+        }
+    }
+    g_strfreev(opts);
+}
+
 static void handle_arg_singlestep(const char *arg)
 {
     singlestep = 1;
@@ -4047,6 +4012,16 @@ static void handle_arg_strace(const char *arg)
     do_strace = 1;
 }
 
+static void handle_arg_tb_stats(const char *arg)
+{
+    tb_stats_enable(arg);
+}
+
+static void handle_arg_tb_cache(const char *arg)
+{
+    tb_cache_enable(arg);
+}
+
 static void handle_arg_version(const char *arg)
 {
     printf("qemu-" TARGET_NAME " version " QEMU_VERSION QEMU_PKGVERSION
@@ -4061,6 +4036,113 @@ static void handle_arg_trace(const char *arg)
     trace_file = trace_opt_parse(arg);
 }
 
+#if defined(TARGET_MIPS)
+static void handle_arg_msa_trace(const char *arg)
+{
+    msa_trace_file = strcmp(arg, "none") ? arg : NULL;
+}
+
+static void handle_arg_msa_metrics(const char *arg)
+{
+    msa_metrics_file = arg;
+}
+
+static void handle_arg_msa_profile(const char *arg)
+{
+    msa_profile_file = arg;
+    load_elf_symbols = true;
+}
+
+static void handle_arg_msa_cache(const char *arg)
+{
+    msa_cache_arg = arg;
+    load_elf_symbols = true;
+}
+
+static void handle_arg_trace_roi(const char *arg)
+{
+    msa_trace_roi = arg;
+    if (strstart(arg, "sym=", NULL)) {
+        load_elf_symbols = true;
+    }
+}
+
+/* Parse -trace-roi once the guest image and its symbols are loaded.  */
+static void msa_trace_setup_roi(const char *arg)
+{
+    const char *p;
+    abi_ulong addr;
+    uint64_t start, end;
+
+    if (strstart(arg, "sym=", &p)) {
+        if (!lookup_symbol_addr(p, &addr)) {
+            fprintf(stderr, "-trace-roi: symbol '%s' not found\n", p);
+            exit(EXIT_FAILURE);
+        }
+        msa_trace_set_roi(addr, MSA_TRACE_ROI_RETURN);
+    } else if (strstart(arg, "pc=", &p)) {
+        if (qemu_strtou64(p, &p, 0, &start) < 0 || !strstart(p, "..", &p) ||
+            qemu_strtou64(p, NULL, 0, &end) < 0 || end <= start) {
+            fprintf(stderr, "-trace-roi: invalid range '%s'\n", arg);
+            exit(EXIT_FAILURE);
+        }
+        msa_trace_set_roi(start, end);
+    } else if (!strcmp(arg, "marker")) {
+        msa_trace_set_roi(MSA_TRACE_ROI_NONE, MSA_TRACE_ROI_NONE);
+    } else {
+        fprintf(stderr, "-trace-roi: expected sym=NAME, pc=START..END "
+                "or marker\n");
+        exit(EXIT_FAILURE);
+    }
+}
+#endif
+
+/*
+ * Key the persistent translation cache by everything that shapes the
+ * generated code besides the host binary: the guest text, the CPU, the
+ * options that change translation and the MSA instrumentation.
+ */
+static void tb_cache_setup(struct image_info *info)
+{
+    uint64_t key = 0xcbf29ce484222325ull;
+    TBCacheLoadFn *load_extra = NULL;
+    TBCacheSaveFn *save_extra = NULL;
+    char *config;
+
+#ifdef PIE
+    /* The cached code holds absolute host addresses and is not relocated */
+    fprintf(stderr, "qemu: -tb-cache needs a QEMU built with --disable-pie, "
+            "ignoring it\n");
+    return;
+#endif
+#if defined(TARGET_MIPS)
+    if (msa_profile_file) {
+        /* The block profile embeds heap addresses in the generated code */
+        fprintf(stderr, "qemu: -tb-cache is ignored with -msa-profile\n");
+        return;
+    }
+    if (msa_trace_enabled()) {
+        load_extra = msa_trace_load_tables;
+        save_extra = msa_trace_save_tables;
+    }
+    config = g_strdup_printf("cpu=%s,singlestep=%d,log=%x,trace=%d,roi=%s",
+                             cpu_model, singlestep, qemu_loglevel,
+                             msa_trace_enabled(),
+                             msa_trace_roi ? msa_trace_roi : "");
+#else
+    config = g_strdup_printf("cpu=%s,singlestep=%d,log=%x",
+                             cpu_model, singlestep, qemu_loglevel);
+#endif
+    if (info->end_code > info->start_code) {
+        key = tb_cache_hash(key, g2h(info->start_code),
+                            info->end_code - info->start_code);
+    }
+    key = tb_cache_hash(key, config, strlen(config));
+    g_free(config);
+
+    tb_cache_init(key, load_extra, save_extra);
+}
+
 struct qemu_argument {
     const char *argv;
     const char *env;
@@ -4095,6 +4177,9 @@ static const struct qemu_argument arg_table[] = {
      "address",    "set guest_base address to 'address'"},
     {"R",          "QEMU_RESERVED_VA", true,  handle_arg_reserved_va,
      "size",       "reserve 'size' bytes for guest virtual address space"},
+    {"guest-mem",  "QEMU_GUEST_MEM",   true,  handle_arg_guest_mem,
+     "huge[,populate]", "back anonymous guest memory with transparent huge "
+     "pages aligned to 2 MiB ('huge') and/or pre-fault it ('populate')"},
     {"d",          "QEMU_LOG",         true,  handle_arg_log,
      "item[,...]", "enable logging of specified items "
      "(use '-d help' for a list of items)"},
@@ -4108,10 +4193,34 @@ static const struct qemu_argument arg_table[] = {
      "",           "run in singlestep mode"},
     {"strace",     "QEMU_STRACE",      false, handle_arg_strace,
      "",           "log system calls"},
+    {"tb-stats",   "QEMU_TB_STATS",    true,  handle_arg_tb_stats,
+     "file",       "write translation block lookup and chaining "
+     "statistics to 'file' ('-' for stderr) at exit"},
+    {"tb-cache",   "QEMU_TB_CACHE",    true,  handle_arg_tb_cache,
+     "file",       "reuse the translated code saved in 'file' by a "
+     "previous run of the same binary, and update it at exit"},
     {"seed",       "QEMU_RAND_SEED",   true,  handle_arg_randseed,
      "",           "Seed for pseudo-random number generator"},
     {"trace",      "QEMU_TRACE",       true,  handle_arg_trace,
      "",           "[[enable=]<pattern>][,events=<file>][,file=<file>]"},
+#if defined(TARGET_MIPS)
+    {"msa-trace",  "QEMU_MSA_TRACE",   true,  handle_arg_msa_trace,
+     "file",       "write the binary MSA profiling trace to 'file' "
+     "(default log_msa, 'none' to disable)"},
+    {"msa-metrics", "QEMU_MSA_METRICS", true, handle_arg_msa_metrics,
+     "file",       "write a JSON summary of the memory access metrics "
+     "to 'file' at exit"},
+    {"msa-profile", "QEMU_MSA_PROFILE", true, handle_arg_msa_profile,
+     "file",       "write a hot block and function report with the "
+     "instruction mix to 'file' at exit"},
+    {"msa-cache",  "QEMU_MSA_CACHE",   true,  handle_arg_msa_cache,
+     "file[,opts]", "simulate the data caches and write a hit/miss report "
+     "to 'file' at exit; opts: l1=size:ways:line, l2=size:ways:line, "
+     "repl=lru|plru, prefetch=none|next|stride"},
+    {"trace-roi",  "QEMU_TRACE_ROI",   true,  handle_arg_trace_roi,
+     "region",     "only trace 'sym=func', 'pc=start..end' or from the "
+     "guest start marker ('marker')"},
+#endif
     {"version",    "QEMU_VERSION",     false, handle_arg_version,
      "",           "display version information and exit"},
     {NULL, NULL, false, NULL, NULL, NULL}
@@ -4310,6 +4419,10 @@ int main(int argc, char **argv, char **envp)
         exit(1);
     }
     trace_init_file(trace_file);
+#if defined(TARGET_MIPS)
+    msa_trace_open(msa_trace_file, msa_metrics_file, msa_profile_file,
+                   msa_cache_arg);
+#endif
 
     /* Zero out regs */
     memset(regs, 0, sizeof(struct target_pt_regs));
@@ -4406,6 +4519,11 @@ int main(int argc, char **argv, char **envp)
             mmap_next_start = reserved_va;
         }
     }
+    if ((guest_mem_flags & GUEST_MEM_HUGE) &&
+        (guest_base & (GUEST_MEM_HUGE_SIZE - 1))) {
+        fprintf(stderr, "qemu: warning: guest_base 0x%lx is not 2 MiB "
+                "aligned, guest memory may not get huge pages\n", guest_base);
+    }
 
     /*
      * Read in mmap_min_addr kernel parameter.  This value is used
@@ -4780,6 +4898,12 @@ int main(int argc, char **argv, char **envp)
             }
             restore_snan_bit_mode(env);
         }
+        if (msa_trace_roi) {
+            msa_trace_setup_roi(msa_trace_roi);
+        }
+        if (msa_trace_enabled() && !msa_trace_roi_set()) {
+            env->hflags |= MIPS_HFLAG_TRACE;
+        }
     }
 #elif defined(TARGET_NIOS2)
     {
@@ -4900,6 +5024,10 @@ int main(int argc, char **argv, char **envp)
     ts->heap_limit = 0;
 #endif
 
+    if (tb_cache_enabled()) {
+        tb_cache_setup(info);
+    }
+
     if (gdbstub_port) {
         if (gdbserver_start(gdbstub_port) < 0) {
             fprintf(stderr, "qemu: could not open gdbserver on port %d\n",
@@ -26,6 +26,7 @@ static inline void cpu_clone_regs(CPUMIPSState *env, target_ulong newsp)
     }
     env->active_tc.gpr[7] = 0;
     env->active_tc.gpr[2] = 0;
+    msa_trace_cpu_reset(env);
 }
 
 static inline void cpu_set_tls(CPUMIPSState *env, target_ulong newtls)
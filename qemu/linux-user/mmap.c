@@ -198,6 +198,46 @@ static int mmap_frag(abi_ulong real_start,
 #endif
 abi_ulong mmap_next_start = TASK_UNMAPPED_BASE;
 
+int guest_mem_flags;
+
+/*
+ * Apply -guest-mem to the new anonymous private mapping at
+ * [start, start + len), restricted to the host pages it covers fully.
+ * Both are hints and errors are ignored.
+ */
+static void mmap_guest_mem(abi_ulong start, abi_ulong len, int prot)
+{
+    abi_ulong real_start = HOST_PAGE_ALIGN(start);
+    abi_ulong real_end = (start + len) & qemu_host_page_mask;
+    uint8_t *p;
+
+    if (real_start >= real_end) {
+        return;
+    }
+#ifdef MADV_HUGEPAGE
+    if (guest_mem_flags & GUEST_MEM_HUGE) {
+        madvise(g2h(real_start), real_end - real_start, MADV_HUGEPAGE);
+    }
+#endif
+    if (!(guest_mem_flags & GUEST_MEM_POPULATE) || !(prot & PROT_WRITE)) {
+        return;
+    }
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(g2h(real_start), real_end - real_start,
+                MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    /*
+     * Older kernels: take a write fault on every page.  The cmpxchg
+     * never changes memory, even if another guest thread got there first.
+     */
+    for (p = g2h(real_start); p < (uint8_t *)g2h(real_end);
+         p += qemu_real_host_page_size) {
+        atomic_cmpxchg(p, 0, 0);
+    }
+}
+
 unsigned long last_brk;
 
 /* Subroutine of mmap_find_vma, used when we have pre-allocated a chunk
@@ -553,6 +593,10 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int prot,
         }
     }
  the_end1:
+    if (guest_mem_flags && (flags & MAP_ANONYMOUS) &&
+        (flags & MAP_TYPE) == MAP_PRIVATE) {
+        mmap_guest_mem(start, len, prot);
+    }
     page_set_flags(start, start + len, prot | PAGE_VALID);
  the_end:
 #ifdef DEBUG_MMAP
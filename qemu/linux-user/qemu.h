@@ -190,6 +190,8 @@ int loader_exec(int fdexec, const char *filename, char **argv, char **envp,
 
 int load_elf_binary(struct linux_binprm *bprm, struct image_info *info);
 int load_flt_binary(struct linux_binprm *bprm, struct image_info *info);
+bool lookup_symbol_addr(const char *name, abi_ulong *addr);
+extern bool load_elf_symbols;
 
 abi_long memcpy_to_target(abi_ulong dest, const void *src,
                           unsigned long len);
@@ -432,6 +434,11 @@ abi_long target_mremap(abi_ulong old_addr, abi_ulong old_size,
 int target_msync(abi_ulong start, abi_ulong len, int flags);
 extern unsigned long last_brk;
 extern abi_ulong mmap_next_start;
+/* -guest-mem: host backing of anonymous guest memory */
+#define GUEST_MEM_HUGE          1   /* transparent huge pages */
+#define GUEST_MEM_POPULATE      2   /* pre-faulted when mapped */
+#define GUEST_MEM_HUGE_SIZE     (2 * 1024 * 1024)
+extern int guest_mem_flags;
 abi_ulong mmap_find_vma(abi_ulong, abi_ulong);
 void mmap_fork_start(void);
 void mmap_fork_end(int child);
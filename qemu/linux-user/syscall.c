@@ -116,6 +116,9 @@ int __clone2(int (*fn)(void *), void *child_stack_base,
 #include "uname.h"
 
 #include "qemu.h"
+#if defined(TARGET_MIPS)
+#include "target/mips/msa_trace.h"
+#endif
 
 #ifndef CLONE_IO
 #define CLONE_IO                0x80000000      /* Clone io context */
@@ -7780,6 +7783,9 @@ abi_long do_syscall(void *cpu_env, int num, abi_long arg1,
                 sys_futex(g2h(ts->child_tidptr), FUTEX_WAKE, INT_MAX,
                           NULL, NULL, 0);
             }
+#if defined(TARGET_MIPS)
+            msa_trace_cpu_release(cpu_env);
+#endif
             thread_cpu = NULL;
             object_unref(OBJECT(cpu));
             g_free(ts);
@@ -7791,6 +7797,11 @@ abi_long do_syscall(void *cpu_env, int num, abi_long arg1,
 #ifdef TARGET_GPROF
         _mcleanup();
 #endif
+        tb_cache_save();
+#if defined(TARGET_MIPS)
+        msa_trace_close();
+#endif
+        tb_stats_report();
         gdb_exit(cpu_env, arg1);
         _exit(arg1);
         ret = 0; /* avoid warning */
@@ -9866,6 +9877,11 @@ abi_long do_syscall(void *cpu_env, int num, abi_long arg1,
 #ifdef TARGET_GPROF
         _mcleanup();
 #endif
+        tb_cache_save();
+#if defined(TARGET_MIPS)
+        msa_trace_close();
+#endif
+        tb_stats_report();
         gdb_exit(cpu_env, arg1);
         ret = get_errno(exit_group(arg1));
         break;
@@ -10,6 +10,7 @@
 #include "mips-defs.h"
 #include "exec/cpu-defs.h"
 #include "fpu/softfloat.h"
+#include "msa_trace.h"
 
 struct CPUMIPSState;
 
@@ -485,8 +486,6 @@ struct CPUMIPSState {
     /* XXX: Maybe make LLAddr per-TC? */
     uint64_t lladdr;
     target_ulong llval;
-    target_ulong llnewval;
-    target_ulong llreg;
     uint64_t CP0_LLAddr_rw_bitmask;
     int CP0_LLAddr_shift;
     target_ulong CP0_WatchLo[8];
@@ -585,6 +584,7 @@ struct CPUMIPSState {
 #define MIPS_HFLAG_ELPA  0x4000000
 #define MIPS_HFLAG_ITC_CACHE  0x8000000 /* CACHE instr. operates on ITC tag */
 #define MIPS_HFLAG_ERL   0x10000000 /* error level flag */
+#define MIPS_HFLAG_TRACE 0x20000000 /* inside the MSA trace region */
     target_ulong btarget;        /* Jump / branch target               */
     target_ulong bcond;          /* Branch condition (if needed)       */
 
@@ -610,6 +610,13 @@ struct CPUMIPSState {
     QEMUTimer *timer; /* Internal timer */
     MemoryRegion *itc_tag; /* ITC Configuration Tags */
     target_ulong exception_base; /* ExceptionBase input to the core */
+
+    /* MSA profiling trace, see msa_trace.h */
+    MSATraceBuffer *trace_buf;
+    uint64_t *trace_pos;       /* next free record, advanced by TCG code */
+    uint64_t *trace_end;
+    uint64_t trace_counts[MSA_TRACE_MAX_OPCODES];
+    target_ulong trace_roi_ret; /* return address of the ROI entry */
 };
 
 /**
@@ -726,7 +733,7 @@ enum {
 
     EXCP_LAST = EXCP_TLBRI,
 };
-/* Dummy exception for conditional stores.  */
+/* Exceptions from here on are internal to QEMU.  */
 #define EXCP_SC 0x100
 
 /*
@@ -766,7 +773,7 @@ static inline void cpu_get_tb_cpu_state(CPUMIPSState *env, target_ulong *pc,
     *pc = env->active_tc.PC;
     *cs_base = 0;
     *flags = env->hflags & (MIPS_HFLAG_TMASK | MIPS_HFLAG_BMASK |
-                            MIPS_HFLAG_HWRENA_ULR);
+                            MIPS_HFLAG_HWRENA_ULR | MIPS_HFLAG_TRACE);
 }
 
 #endif /* MIPS_CPU_H */
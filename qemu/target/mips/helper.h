@@ -3,6 +3,8 @@ DEF_HELPER_2(raise_exception, noreturn, env, i32)
 DEF_HELPER_1(raise_exception_debug, noreturn, env)
 
 DEF_HELPER_1(do_semihosting, void, env)
+DEF_HELPER_1(msa_trace_flush, void, env)
+DEF_HELPER_FLAGS_1(msa_trace_block_count, TCG_CALL_NO_RWG, void, ptr)
 
 #ifdef TARGET_MIPS64
 DEF_HELPER_4(sdl, void, env, tl, tl, int)
@@ -946,6 +948,101 @@ DEF_HELPER_4(msa_ftint_u_df, void, env, i32, i32, i32)
 DEF_HELPER_4(msa_ffint_s_df, void, env, i32, i32, i32)
 DEF_HELPER_4(msa_ffint_u_df, void, env, i32, i32, i32)
 
+/* Per data format instances of the element-wise helpers, see msa_helper.c.
+   They access only their operand registers, which the translator writes
+   back and reloads around the call.  */
+#define MSA_DF_PROTO(op, arg)                               \
+DEF_HELPER_FLAGS_4(msa_ ## op ## _b, TCG_CALL_NO_RWG,       \
+                   void, env, i32, i32, arg)                \
+DEF_HELPER_FLAGS_4(msa_ ## op ## _h, TCG_CALL_NO_RWG,       \
+                   void, env, i32, i32, arg)                \
+DEF_HELPER_FLAGS_4(msa_ ## op ## _w, TCG_CALL_NO_RWG,       \
+                   void, env, i32, i32, arg)                \
+DEF_HELPER_FLAGS_4(msa_ ## op ## _d, TCG_CALL_NO_RWG,       \
+                   void, env, i32, i32, arg)
+MSA_DF_PROTO(addvi, s32)
+MSA_DF_PROTO(subvi, s32)
+MSA_DF_PROTO(ceqi, s32)
+MSA_DF_PROTO(clei_s, s32)
+MSA_DF_PROTO(clei_u, s32)
+MSA_DF_PROTO(clti_s, s32)
+MSA_DF_PROTO(clti_u, s32)
+MSA_DF_PROTO(maxi_s, s32)
+MSA_DF_PROTO(maxi_u, s32)
+MSA_DF_PROTO(mini_s, s32)
+MSA_DF_PROTO(mini_u, s32)
+MSA_DF_PROTO(slli, i32)
+MSA_DF_PROTO(srai, i32)
+MSA_DF_PROTO(srli, i32)
+MSA_DF_PROTO(bclri, i32)
+MSA_DF_PROTO(bseti, i32)
+MSA_DF_PROTO(bnegi, i32)
+MSA_DF_PROTO(sat_s, i32)
+MSA_DF_PROTO(sat_u, i32)
+MSA_DF_PROTO(srari, i32)
+MSA_DF_PROTO(srlri, i32)
+MSA_DF_PROTO(sll, i32)
+MSA_DF_PROTO(sra, i32)
+MSA_DF_PROTO(srl, i32)
+MSA_DF_PROTO(bclr, i32)
+MSA_DF_PROTO(bset, i32)
+MSA_DF_PROTO(bneg, i32)
+MSA_DF_PROTO(addv, i32)
+MSA_DF_PROTO(subv, i32)
+MSA_DF_PROTO(max_s, i32)
+MSA_DF_PROTO(max_u, i32)
+MSA_DF_PROTO(min_s, i32)
+MSA_DF_PROTO(min_u, i32)
+MSA_DF_PROTO(max_a, i32)
+MSA_DF_PROTO(min_a, i32)
+MSA_DF_PROTO(ceq, i32)
+MSA_DF_PROTO(clt_s, i32)
+MSA_DF_PROTO(clt_u, i32)
+MSA_DF_PROTO(cle_s, i32)
+MSA_DF_PROTO(cle_u, i32)
+MSA_DF_PROTO(add_a, i32)
+MSA_DF_PROTO(adds_a, i32)
+MSA_DF_PROTO(adds_s, i32)
+MSA_DF_PROTO(adds_u, i32)
+MSA_DF_PROTO(ave_s, i32)
+MSA_DF_PROTO(ave_u, i32)
+MSA_DF_PROTO(aver_s, i32)
+MSA_DF_PROTO(aver_u, i32)
+MSA_DF_PROTO(subs_s, i32)
+MSA_DF_PROTO(subs_u, i32)
+MSA_DF_PROTO(subsus_u, i32)
+MSA_DF_PROTO(subsuu_s, i32)
+MSA_DF_PROTO(asub_s, i32)
+MSA_DF_PROTO(asub_u, i32)
+MSA_DF_PROTO(mulv, i32)
+MSA_DF_PROTO(div_s, i32)
+MSA_DF_PROTO(div_u, i32)
+MSA_DF_PROTO(mod_s, i32)
+MSA_DF_PROTO(mod_u, i32)
+MSA_DF_PROTO(dotp_s, i32)
+MSA_DF_PROTO(dotp_u, i32)
+MSA_DF_PROTO(srar, i32)
+MSA_DF_PROTO(srlr, i32)
+MSA_DF_PROTO(hadd_s, i32)
+MSA_DF_PROTO(hadd_u, i32)
+MSA_DF_PROTO(hsub_s, i32)
+MSA_DF_PROTO(hsub_u, i32)
+MSA_DF_PROTO(mul_q, i32)
+MSA_DF_PROTO(mulr_q, i32)
+MSA_DF_PROTO(maddv, i32)
+MSA_DF_PROTO(msubv, i32)
+MSA_DF_PROTO(dpadd_s, i32)
+MSA_DF_PROTO(dpadd_u, i32)
+MSA_DF_PROTO(dpsub_s, i32)
+MSA_DF_PROTO(dpsub_u, i32)
+MSA_DF_PROTO(binsl, i32)
+MSA_DF_PROTO(binsr, i32)
+MSA_DF_PROTO(madd_q, i32)
+MSA_DF_PROTO(msub_q, i32)
+MSA_DF_PROTO(maddr_q, i32)
+MSA_DF_PROTO(msubr_q, i32)
+#undef MSA_DF_PROTO
+
 #define MSALDST_PROTO(type)                         \
 DEF_HELPER_3(msa_ld_ ## type, void, env, i32, tl)   \
 DEF_HELPER_3(msa_st_ ## type, void, env, i32, tl)
@@ -0,0 +1,502 @@
+/*
+ * Data cache model for MSA profiling.
+ *
+ * Replays the memory access records of the trace through a two-level
+ * set-associative data cache: a write-allocate L1D backed by a
+ * non-inclusive L2, each with its own size, associativity, line size and
+ * LRU or tree-PLRU replacement, and an optional prefetcher filling the
+ * L1D.  An access that straddles lines looks up every line it touches,
+ * so counts are in line references.
+ *
+ * Hits, misses and evictions are charged to the load/store site that
+ * caused them, which gives per-PC and per-function numbers as well as
+ * the split between MSA LD/ST and scalar accesses.  Prefetch fills are
+ * only counted globally.
+ *
+ * The options are a comma separated list of
+ *
+ *   l1=SIZE:WAYS:LINE  l2=SIZE:WAYS:LINE  repl=lru|plru
+ *   prefetch=none|next|stride
+ *
+ * "next" fetches the following line on every L1D miss; "stride" tracks
+ * the last address and stride of every site and fetches one stride
+ * ahead once the same stride has been seen twice in a row.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "disas/disas.h"
+#include "msa_trace.h"
+#include "msa_cache.h"
+
+enum {
+    MSA_CACHE_PREFETCH_NONE,
+    MSA_CACHE_PREFETCH_NEXT,
+    MSA_CACHE_PREFETCH_STRIDE,
+};
+
+/* Same stride seen this many times in a row before it is prefetched */
+#define MSA_CACHE_STRIDE_CONFIDENCE 2
+
+typedef struct MSACacheLevel {
+    const char *name;
+    uint64_t size;
+    unsigned ways;
+    unsigned line_shift;
+    uint64_t set_mask;
+    bool plru;
+    uint64_t *tags;             /* line number + 1 per way, 0 if invalid */
+    uint64_t *ages;             /* LRU: last use of every way */
+    uint64_t *plru_bits;        /* PLRU: tree of every set */
+    bool *prefetched;           /* filled by the prefetcher, not used yet */
+    uint64_t clock;
+} MSACacheLevel;
+
+typedef struct MSACacheStats {
+    uint64_t refs;
+    uint64_t l1_misses;
+    uint64_t l1_evictions;
+    uint64_t l2_misses;
+    uint64_t l2_evictions;
+} MSACacheStats;
+
+typedef struct MSACacheSite {
+    MSACacheStats stats;
+    uint64_t last_addr;
+    int64_t stride;
+    unsigned confidence;
+} MSACacheSite;
+
+struct MSACache {
+    MSACacheLevel l1, l2;
+    int prefetch;
+    uint64_t prefetches;
+    uint64_t useful_prefetches;
+    const MSATraceSite *trace_sites;
+    const MSATraceOpcode *opcodes;
+    MSACacheSite *sites;
+};
+
+static bool msa_cache_parse_level(MSACacheLevel *l, const char *p)
+{
+    uint64_t ways, line;
+    char *end;
+
+    if (qemu_strtosz(p, &end, &l->size) < 0 || *end != ':' ||
+        qemu_strtou64(end + 1, &p, 10, &ways) < 0 || *p != ':' ||
+        qemu_strtou64(p + 1, NULL, 10, &line) < 0) {
+        error_report("-msa-cache: %s: expected SIZE:WAYS:LINE", l->name);
+        return false;
+    }
+    if (!is_power_of_2(line) || !ways || ways > MSA_CACHE_MAX_WAYS ||
+        l->size % (ways * line) || !is_power_of_2(l->size / (ways * line))) {
+        error_report("-msa-cache: %s: the line size and the number of sets "
+                     "must be powers of 2, with 1 to %d ways",
+                     l->name, MSA_CACHE_MAX_WAYS);
+        return false;
+    }
+    l->ways = ways;
+    l->line_shift = ctz64(line);
+    l->set_mask = l->size / (ways * line) - 1;
+    return true;
+}
+
+static bool msa_cache_init_level(MSACacheLevel *l)
+{
+    size_t lines = (l->set_mask + 1) * l->ways;
+
+    if (l->plru && !is_power_of_2(l->ways)) {
+        error_report("-msa-cache: %s: PLRU needs a power of 2 ways", l->name);
+        return false;
+    }
+    l->tags = g_new0(uint64_t, lines);
+    l->prefetched = g_new0(bool, lines);
+    if (l->plru) {
+        l->plru_bits = g_new0(uint64_t, l->set_mask + 1);
+    } else {
+        l->ages = g_new0(uint64_t, lines);
+    }
+    return true;
+}
+
+static void msa_cache_free_level(MSACacheLevel *l)
+{
+    g_free(l->tags);
+    g_free(l->prefetched);
+    g_free(l->plru_bits);
+    g_free(l->ages);
+}
+
+/*
+ * Create a cache model for @opts.  @sites and @opcodes are the trace
+ * tables records refer to; they are read as records are added.
+ */
+MSACache *msa_cache_new(const char *opts, const MSATraceSite *sites,
+                        const MSATraceOpcode *opcodes)
+{
+    MSACache *c = g_new0(MSACache, 1);
+    char **args = g_strsplit(opts, ",", 0);
+    const char *l1 = MSA_CACHE_L1_DEFAULT;
+    const char *l2 = MSA_CACHE_L2_DEFAULT;
+    bool plru = false;
+    const char *p;
+    char **arg;
+
+    for (arg = args; *arg; arg++) {
+        if (!**arg) {
+            continue;
+        } else if (strstart(*arg, "l1=", &p)) {
+            l1 = p;
+        } else if (strstart(*arg, "l2=", &p)) {
+            l2 = p;
+        } else if (!strcmp(*arg, "repl=lru")) {
+            plru = false;
+        } else if (!strcmp(*arg, "repl=plru")) {
+            plru = true;
+        } else if (!strcmp(*arg, "prefetch=none")) {
+            c->prefetch = MSA_CACHE_PREFETCH_NONE;
+        } else if (!strcmp(*arg, "prefetch=next")) {
+            c->prefetch = MSA_CACHE_PREFETCH_NEXT;
+        } else if (!strcmp(*arg, "prefetch=stride")) {
+            c->prefetch = MSA_CACHE_PREFETCH_STRIDE;
+        } else {
+            error_report("-msa-cache: unknown option '%s'", *arg);
+            goto fail;
+        }
+    }
+
+    c->l1.name = "L1D";
+    c->l2.name = "L2";
+    c->l1.plru = c->l2.plru = plru;
+    if (!msa_cache_parse_level(&c->l1, l1) ||
+        !msa_cache_parse_level(&c->l2, l2) ||
+        !msa_cache_init_level(&c->l1) || !msa_cache_init_level(&c->l2)) {
+        goto fail;
+    }
+    c->trace_sites = sites;
+    c->opcodes = opcodes;
+    c->sites = g_new0(MSACacheSite, MSA_TRACE_MAX_SITES);
+    g_strfreev(args);
+    return c;
+
+fail:
+    g_strfreev(args);
+    msa_cache_free(c);
+    return NULL;
+}
+
+void msa_cache_free(MSACache *c)
+{
+    msa_cache_free_level(&c->l1);
+    msa_cache_free_level(&c->l2);
+    g_free(c->sites);
+    g_free(c);
+}
+
+/* Make @way the most recently used way of @set */
+static void msa_cache_touch(MSACacheLevel *l, uint64_t set, unsigned way)
+{
+    uint64_t *bits;
+    unsigned node = 1;
+    int shift;
+
+    if (!l->plru) {
+        l->ages[set * l->ways + way] = ++l->clock;
+        return;
+    }
+    /* Every node on the path points away from the way just used */
+    bits = &l->plru_bits[set];
+    for (shift = ctz32(l->ways) - 1; shift >= 0; shift--) {
+        unsigned b = (way >> shift) & 1;
+
+        if (b) {
+            *bits &= ~(1ULL << node);
+        } else {
+            *bits |= 1ULL << node;
+        }
+        node = node * 2 + b;
+    }
+}
+
+static unsigned msa_cache_victim(MSACacheLevel *l, uint64_t set)
+{
+    uint64_t *tags = &l->tags[set * l->ways];
+    unsigned way, victim = 0;
+    unsigned node = 1;
+    int shift;
+
+    for (way = 0; way < l->ways; way++) {
+        if (!tags[way]) {
+            return way;
+        }
+    }
+    if (l->plru) {
+        for (shift = ctz32(l->ways) - 1; shift >= 0; shift--) {
+            unsigned b = (l->plru_bits[set] >> node) & 1;
+
+            victim = victim * 2 + b;
+            node = node * 2 + b;
+        }
+        return victim;
+    }
+    for (way = 1; way < l->ways; way++) {
+        if (l->ages[set * l->ways + way] < l->ages[set * l->ways + victim]) {
+            victim = way;
+        }
+    }
+    return victim;
+}
+
+/*
+ * Look up @addr in @l, filling its line on a miss.  Return true on a
+ * hit; *@evicted tells whether the fill replaced a valid line.
+ */
+static bool msa_cache_lookup(MSACacheLevel *l, uint64_t addr, bool prefetch,
+                             bool *evicted, bool *useful)
+{
+    uint64_t line = addr >> l->line_shift;
+    uint64_t set = line & l->set_mask;
+    uint64_t *tags = &l->tags[set * l->ways];
+    unsigned way;
+
+    *evicted = *useful = false;
+    for (way = 0; way < l->ways; way++) {
+        if (tags[way] == line + 1) {
+            if (!prefetch) {
+                *useful = l->prefetched[set * l->ways + way];
+                l->prefetched[set * l->ways + way] = false;
+                msa_cache_touch(l, set, way);
+            }
+            return true;
+        }
+    }
+    way = msa_cache_victim(l, set);
+    *evicted = tags[way] != 0;
+    tags[way] = line + 1;
+    l->prefetched[set * l->ways + way] = prefetch;
+    msa_cache_touch(l, set, way);
+    return false;
+}
+
+static void msa_cache_prefetch(MSACache *c, uint64_t addr)
+{
+    bool evicted, useful;
+
+    if (addr > MSA_TRACE_ADDR_MASK ||
+        msa_cache_lookup(&c->l1, addr, true, &evicted, &useful)) {
+        return;
+    }
+    c->prefetches++;
+    msa_cache_lookup(&c->l2, addr, true, &evicted, &useful);
+}
+
+/* One line reference by @site; return true on an L1D miss */
+static bool msa_cache_ref(MSACache *c, MSACacheSite *site, uint64_t addr)
+{
+    bool evicted, useful;
+
+    site->stats.refs++;
+    if (msa_cache_lookup(&c->l1, addr, false, &evicted, &useful)) {
+        c->useful_prefetches += useful;
+        return false;
+    }
+    site->stats.l1_misses++;
+    site->stats.l1_evictions += evicted;
+    if (!msa_cache_lookup(&c->l2, addr, false, &evicted, &useful)) {
+        site->stats.l2_misses++;
+        site->stats.l2_evictions += evicted;
+    }
+    return true;
+}
+
+static void msa_cache_access(MSACache *c, int id, uint64_t addr)
+{
+    MSACacheSite *site = &c->sites[id];
+    unsigned size = c->opcodes[c->trace_sites[id].opc].size;
+    uint64_t line_size = 1ULL << c->l1.line_shift;
+    uint64_t line, last;
+    bool miss = false;
+    int64_t stride;
+
+    last = (addr + MAX(size, 1) - 1) >> c->l1.line_shift;
+    for (line = addr >> c->l1.line_shift; line <= last; line++) {
+        miss |= msa_cache_ref(c, site, MAX(line * line_size, addr));
+    }
+
+    switch (c->prefetch) {
+    case MSA_CACHE_PREFETCH_NEXT:
+        if (miss) {
+            msa_cache_prefetch(c, (last + 1) * line_size);
+        }
+        break;
+    case MSA_CACHE_PREFETCH_STRIDE:
+        stride = addr - site->last_addr;
+        if (stride && stride == site->stride) {
+            if (site->confidence < MSA_CACHE_STRIDE_CONFIDENCE) {
+                site->confidence++;
+            }
+        } else {
+            site->stride = stride;
+            site->confidence = 0;
+        }
+        site->last_addr = addr;
+        if (site->confidence == MSA_CACHE_STRIDE_CONFIDENCE) {
+            msa_cache_prefetch(c, addr + stride);
+        }
+        break;
+    }
+}
+
+void msa_cache_add(MSACache *c, const uint64_t *records, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        msa_cache_access(c, MSA_TRACE_REC_SITE(records[i]),
+                         MSA_TRACE_REC_ADDR(records[i]));
+    }
+}
+
+static void msa_cache_stats_add(MSACacheStats *sum, const MSACacheStats *s)
+{
+    sum->refs += s->refs;
+    sum->l1_misses += s->l1_misses;
+    sum->l1_evictions += s->l1_evictions;
+    sum->l2_misses += s->l2_misses;
+    sum->l2_evictions += s->l2_evictions;
+}
+
+static const char msa_cache_header[] =
+    "        refs    l1_misses l1_evictions    l2_misses l2_evictions"
+    "  l1_miss%  l2_miss%";
+
+static void msa_cache_print_stats(FILE *f, const MSACacheStats *s)
+{
+    fprintf(f, "%12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+            " %12" PRIu64 "  %8.2f  %8.2f", s->refs, s->l1_misses,
+            s->l1_evictions, s->l2_misses, s->l2_evictions,
+            s->refs ? 100.0 * s->l1_misses / s->refs : 0,
+            s->l1_misses ? 100.0 * s->l2_misses / s->l1_misses : 0);
+}
+
+static void msa_cache_print_level(FILE *f, const MSACacheLevel *l)
+{
+    fprintf(f, "%-4s %8" PRIu64 " bytes, %u ways, %u-byte lines, %s\n",
+            l->name, l->size, l->ways, 1U << l->line_shift,
+            l->plru ? "PLRU" : "LRU");
+}
+
+typedef struct MSACacheFunc {
+    const char *name;
+    MSACacheStats stats;
+} MSACacheFunc;
+
+static int msa_cache_site_cmp(const void *a, const void *b)
+{
+    uint64_t x = (*(MSACacheSite * const *)a)->stats.l1_misses;
+    uint64_t y = (*(MSACacheSite * const *)b)->stats.l1_misses;
+
+    return x > y ? -1 : x < y;
+}
+
+static int msa_cache_func_cmp(const void *a, const void *b)
+{
+    uint64_t x = (*(MSACacheFunc * const *)a)->stats.l1_misses;
+    uint64_t y = (*(MSACacheFunc * const *)b)->stats.l1_misses;
+
+    return x > y ? -1 : x < y;
+}
+
+/*
+ * Write the cache report for the first @nr_sites sites: totals for
+ * scalar and MSA accesses, then sites and functions sorted by L1D
+ * misses.
+ */
+void msa_cache_write(MSACache *c, FILE *f, int nr_sites)
+{
+    static const char *const prefetchers[] = { "none", "next", "stride" };
+    MSACacheStats scalar = { 0 }, msa = { 0 }, total = { 0 };
+    MSACacheSite **sites = g_new(MSACacheSite *, nr_sites);
+    MSACacheFunc **funcs = g_new(MSACacheFunc *, nr_sites);
+    GHashTable *func_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    MSACacheFunc *fn;
+    int nr_funcs = 0;
+    int i;
+
+    for (i = 0; i < nr_sites; i++) {
+        const MSATraceSite *ts = &c->trace_sites[i];
+        const char *name = lookup_symbol(ts->pc);
+
+        sites[i] = &c->sites[i];
+        if (c->opcodes[ts->opc].flags & MSA_TRACE_F_MSA) {
+            msa_cache_stats_add(&msa, &c->sites[i].stats);
+        } else {
+            msa_cache_stats_add(&scalar, &c->sites[i].stats);
+        }
+        if (!name[0]) {
+            name = "?";
+        }
+        fn = g_hash_table_lookup(func_ids, name);
+        if (!fn) {
+            fn = g_new0(MSACacheFunc, 1);
+            fn->name = name;
+            funcs[nr_funcs++] = fn;
+            g_hash_table_insert(func_ids, (gpointer)name, fn);
+        }
+        msa_cache_stats_add(&fn->stats, &c->sites[i].stats);
+    }
+    msa_cache_stats_add(&total, &scalar);
+    msa_cache_stats_add(&total, &msa);
+    qsort(sites, nr_sites, sizeof(*sites), msa_cache_site_cmp);
+    qsort(funcs, nr_funcs, sizeof(*funcs), msa_cache_func_cmp);
+
+    fprintf(f, "Cache model\n\n");
+    msa_cache_print_level(f, &c->l1);
+    msa_cache_print_level(f, &c->l2);
+    fprintf(f, "prefetch %s: %" PRIu64 " lines, %" PRIu64 " used\n",
+            prefetchers[c->prefetch], c->prefetches, c->useful_prefetches);
+
+    fprintf(f, "\nAccesses\n\n");
+    fprintf(f, "          %s\n", msa_cache_header);
+    fprintf(f, "scalar    ");
+    msa_cache_print_stats(f, &scalar);
+    fprintf(f, "\nmsa       ");
+    msa_cache_print_stats(f, &msa);
+    fprintf(f, "\ntotal     ");
+    msa_cache_print_stats(f, &total);
+    fprintf(f, "\n");
+
+    fprintf(f, "\nSites\n\n");
+    fprintf(f, "                pc  opcode                  %s  function\n",
+            msa_cache_header);
+    for (i = 0; i < nr_sites && sites[i]->stats.refs; i++) {
+        const MSATraceSite *ts = &c->trace_sites[sites[i] - c->sites];
+        const char *name = lookup_symbol(ts->pc);
+
+        fprintf(f, "0x%016" PRIx64 "  %-*s", ts->pc, MSA_TRACE_NAME_LEN,
+                c->opcodes[ts->opc].name);
+        msa_cache_print_stats(f, &sites[i]->stats);
+        fprintf(f, "  %s\n", name[0] ? name : "?");
+    }
+
+    fprintf(f, "\nFunctions\n\n");
+    fprintf(f, "%s  function\n", msa_cache_header);
+    for (i = 0; i < nr_funcs; i++) {
+        fn = funcs[i];
+        if (fn->stats.refs) {
+            msa_cache_print_stats(f, &fn->stats);
+            fprintf(f, "  %s\n", fn->name);
+        }
+        g_free(fn);
+    }
+
+    g_hash_table_destroy(func_ids);
+    g_free(funcs);
+    g_free(sites);
+}
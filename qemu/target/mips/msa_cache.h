@@ -0,0 +1,27 @@
+/*
+ * Data cache model for MSA profiling.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef MIPS_MSA_CACHE_H
+#define MIPS_MSA_CACHE_H
+
+/*
+ * Default geometry, "size:ways:line" as accepted by -msa-cache: the
+ * I6400 L1 data cache and a typical L2 configuration.
+ */
+#define MSA_CACHE_L1_DEFAULT    "32K:4:32"
+#define MSA_CACHE_L2_DEFAULT    "1M:8:64"
+#define MSA_CACHE_MAX_WAYS      64
+
+typedef struct MSACache MSACache;
+
+MSACache *msa_cache_new(const char *opts, const MSATraceSite *sites,
+                        const MSATraceOpcode *opcodes);
+void msa_cache_free(MSACache *c);
+void msa_cache_add(MSACache *c, const uint64_t *records, size_t count);
+void msa_cache_write(MSACache *c, FILE *f, int nr_sites);
+
+#endif
@@ -18,6 +18,8 @@
  */
 
 #include "qemu/osdep.h"
+#include <math.h>
+#include <fenv.h>
 #include "cpu.h"
 #include "internal.h"
 #include "exec/exec-all.h"
@@ -208,38 +210,56 @@ static inline int64_t msa_min_u_df(uint32_t df, int64_t arg1, int64_t arg2)
     return u_arg1 < u_arg2 ? arg1 : arg2;
 }
 
-#define MSA_BINOP_IMM_DF(helper, func)                                  \
-void helper_msa_ ## helper ## _df(CPUMIPSState *env, uint32_t df,       \
-                        uint32_t wd, uint32_t ws, int32_t u5)           \
-{                                                                       \
-    wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                          \
-    wr_t *pws = &(env->active_fpu.fpr[ws].wr);                          \
-    uint32_t i;                                                         \
-                                                                        \
+/*
+ * The element-wise helpers below are instantiated per data format, with
+ * DF a constant in each instance (helper_msa_<op>_b/_h/_w/_d), so that
+ * the loop runs over the native element type and the host compiler can
+ * vectorize it.  The translator calls the instance for the format of
+ * the instruction; helper_msa_<op>_df dispatches at run time for the
+ * callers that compute the format.
+ */
+#define MSA_DF_DISPATCH(helper, df, ...)                                \
     switch (df) {                                                       \
     case DF_BYTE:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_BYTE); i++) {                    \
-            pwd->b[i] = msa_ ## func ## _df(df, pws->b[i], u5);         \
-        }                                                               \
+        helper_msa_ ## helper ## _b(__VA_ARGS__);                       \
         break;                                                          \
     case DF_HALF:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_HALF); i++) {                    \
-            pwd->h[i] = msa_ ## func ## _df(df, pws->h[i], u5);         \
-        }                                                               \
+        helper_msa_ ## helper ## _h(__VA_ARGS__);                       \
         break;                                                          \
     case DF_WORD:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_WORD); i++) {                    \
-            pwd->w[i] = msa_ ## func ## _df(df, pws->w[i], u5);         \
-        }                                                               \
+        helper_msa_ ## helper ## _w(__VA_ARGS__);                       \
         break;                                                          \
     case DF_DOUBLE:                                                     \
-        for (i = 0; i < DF_ELEMENTS(DF_DOUBLE); i++) {                  \
-            pwd->d[i] = msa_ ## func ## _df(df, pws->d[i], u5);         \
-        }                                                               \
+        helper_msa_ ## helper ## _d(__VA_ARGS__);                       \
         break;                                                          \
     default:                                                            \
         assert(0);                                                      \
+    }
+
+#define MSA_BINOP_IMM_DF_E(helper, func, df, e)                         \
+void helper_msa_ ## helper ## _ ## e(CPUMIPSState *env, uint32_t wd,    \
+                                     uint32_t ws, int32_t u5)           \
+{                                                                       \
+    wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                          \
+    wr_t *pws = &(env->active_fpu.fpr[ws].wr);                          \
+    wr_t wx;                                                            \
+    uint32_t i;                                                         \
+                                                                        \
+    for (i = 0; i < DF_ELEMENTS(df); i++) {                             \
+        wx.e[i] = msa_ ## func ## _df(df, pws->e[i], u5);               \
     }                                                                   \
+    *pwd = wx;                                                          \
+}
+
+#define MSA_BINOP_IMM_DF(helper, func)                                  \
+MSA_BINOP_IMM_DF_E(helper, func, DF_BYTE, b)                            \
+MSA_BINOP_IMM_DF_E(helper, func, DF_HALF, h)                            \
+MSA_BINOP_IMM_DF_E(helper, func, DF_WORD, w)                            \
+MSA_BINOP_IMM_DF_E(helper, func, DF_DOUBLE, d)                          \
+void helper_msa_ ## helper ## _df(CPUMIPSState *env, uint32_t df,       \
+                        uint32_t wd, uint32_t ws, int32_t u5)           \
+{                                                                       \
+    MSA_DF_DISPATCH(helper, df, env, wd, ws, u5)                        \
 }
 
 MSA_BINOP_IMM_DF(addvi, addv)
@@ -254,6 +274,7 @@ MSA_BINOP_IMM_DF(maxi_u, max_u)
 MSA_BINOP_IMM_DF(mini_s, min_s)
 MSA_BINOP_IMM_DF(mini_u, min_u)
 #undef MSA_BINOP_IMM_DF
+#undef MSA_BINOP_IMM_DF_E
 
 void helper_msa_ldi_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
                        int32_t s10)
@@ -395,38 +416,30 @@ static inline int64_t msa_srlr_df(uint32_t df, int64_t arg1, int64_t arg2)
     }
 }
 
-#define MSA_BINOP_IMMU_DF(helper, func)                                  \
-void helper_msa_ ## helper ## _df(CPUMIPSState *env, uint32_t df, uint32_t wd, \
-                       uint32_t ws, uint32_t u5)                        \
+#define MSA_BINOP_IMMU_DF_E(helper, func, df, e)                        \
+void helper_msa_ ## helper ## _ ## e(CPUMIPSState *env, uint32_t wd,    \
+                                     uint32_t ws, uint32_t u5)          \
 {                                                                       \
     wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                          \
     wr_t *pws = &(env->active_fpu.fpr[ws].wr);                          \
+    wr_t wx;                                                            \
     uint32_t i;                                                         \
                                                                         \
-    switch (df) {                                                       \
-    case DF_BYTE:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_BYTE); i++) {                    \
-            pwd->b[i] = msa_ ## func ## _df(df, pws->b[i], u5);         \
-        }                                                               \
-        break;                                                          \
-    case DF_HALF:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_HALF); i++) {                    \
-            pwd->h[i] = msa_ ## func ## _df(df, pws->h[i], u5);         \
-        }                                                               \
-        break;                                                          \
-    case DF_WORD:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_WORD); i++) {                    \
-            pwd->w[i] = msa_ ## func ## _df(df, pws->w[i], u5);         \
-        }                                                               \
-        break;                                                          \
-    case DF_DOUBLE:                                                     \
-        for (i = 0; i < DF_ELEMENTS(DF_DOUBLE); i++) {                  \
-            pwd->d[i] = msa_ ## func ## _df(df, pws->d[i], u5);         \
-        }                                                               \
-        break;                                                          \
-    default:                                                            \
-        assert(0);                                                      \
+    for (i = 0; i < DF_ELEMENTS(df); i++) {                             \
+        wx.e[i] = msa_ ## func ## _df(df, pws->e[i], u5);               \
     }                                                                   \
+    *pwd = wx;                                                          \
+}
+
+#define MSA_BINOP_IMMU_DF(helper, func)                                 \
+MSA_BINOP_IMMU_DF_E(helper, func, DF_BYTE, b)                           \
+MSA_BINOP_IMMU_DF_E(helper, func, DF_HALF, h)                           \
+MSA_BINOP_IMMU_DF_E(helper, func, DF_WORD, w)                           \
+MSA_BINOP_IMMU_DF_E(helper, func, DF_DOUBLE, d)                         \
+void helper_msa_ ## helper ## _df(CPUMIPSState *env, uint32_t df, uint32_t wd, \
+                       uint32_t ws, uint32_t u5)                        \
+{                                                                       \
+    MSA_DF_DISPATCH(helper, df, env, wd, ws, u5)                        \
 }
 
 MSA_BINOP_IMMU_DF(slli, sll)
@@ -440,6 +453,7 @@ MSA_BINOP_IMMU_DF(sat_u, sat_u)
 MSA_BINOP_IMMU_DF(srari, srar)
 MSA_BINOP_IMMU_DF(srlri, srlr)
 #undef MSA_BINOP_IMMU_DF
+#undef MSA_BINOP_IMMU_DF_E
 
 #define MSA_TEROP_IMMU_DF(helper, func)                                  \
 void helper_msa_ ## helper ## _df(CPUMIPSState *env, uint32_t df,       \
@@ -797,39 +811,31 @@ static inline int64_t msa_mulr_q_df(uint32_t df, int64_t arg1, int64_t arg2)
     return (arg1 * arg2 + r_bit) >> (DF_BITS(df) - 1);
 }
 
-#define MSA_BINOP_DF(func) \
-void helper_msa_ ## func ## _df(CPUMIPSState *env, uint32_t df,         \
-                                uint32_t wd, uint32_t ws, uint32_t wt)  \
+#define MSA_BINOP_DF_E(func, df, e)                                     \
+void helper_msa_ ## func ## _ ## e(CPUMIPSState *env, uint32_t wd,      \
+                                   uint32_t ws, uint32_t wt)            \
 {                                                                       \
     wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                          \
     wr_t *pws = &(env->active_fpu.fpr[ws].wr);                          \
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);                          \
+    wr_t wx;                                                            \
     uint32_t i;                                                         \
                                                                         \
-    switch (df) {                                                       \
-    case DF_BYTE:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_BYTE); i++) {                    \
-            pwd->b[i] = msa_ ## func ## _df(df, pws->b[i], pwt->b[i]);  \
-        }                                                               \
-        break;                                                          \
-    case DF_HALF:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_HALF); i++) {                    \
-            pwd->h[i] = msa_ ## func ## _df(df, pws->h[i], pwt->h[i]);  \
-        }                                                               \
-        break;                                                          \
-    case DF_WORD:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_WORD); i++) {                    \
-            pwd->w[i] = msa_ ## func ## _df(df, pws->w[i], pwt->w[i]);  \
-        }                                                               \
-        break;                                                          \
-    case DF_DOUBLE:                                                     \
-        for (i = 0; i < DF_ELEMENTS(DF_DOUBLE); i++) {                  \
-            pwd->d[i] = msa_ ## func ## _df(df, pws->d[i], pwt->d[i]);  \
-        }                                                               \
-        break;                                                          \
-    default:                                                            \
-        assert(0);                                                      \
+    for (i = 0; i < DF_ELEMENTS(df); i++) {                             \
+        wx.e[i] = msa_ ## func ## _df(df, pws->e[i], pwt->e[i]);        \
     }                                                                   \
+    *pwd = wx;                                                          \
+}
+
+#define MSA_BINOP_DF(func) \
+MSA_BINOP_DF_E(func, DF_BYTE, b)                                        \
+MSA_BINOP_DF_E(func, DF_HALF, h)                                        \
+MSA_BINOP_DF_E(func, DF_WORD, w)                                        \
+MSA_BINOP_DF_E(func, DF_DOUBLE, d)                                      \
+void helper_msa_ ## func ## _df(CPUMIPSState *env, uint32_t df,         \
+                                uint32_t wd, uint32_t ws, uint32_t wt)  \
+{                                                                       \
+    MSA_DF_DISPATCH(func, df, env, wd, ws, wt)                          \
 }
 
 MSA_BINOP_DF(sll)
@@ -882,6 +888,7 @@ MSA_BINOP_DF(hsub_u)
 MSA_BINOP_DF(mul_q)
 MSA_BINOP_DF(mulr_q)
 #undef MSA_BINOP_DF
+#undef MSA_BINOP_DF_E
 
 void helper_msa_sld_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
                        uint32_t ws, uint32_t rt)
@@ -1010,43 +1017,32 @@ static inline int64_t msa_msubr_q_df(uint32_t df, int64_t dest, int64_t arg1,
     return (q_ret < q_min) ? q_min : (q_max < q_ret) ? q_max : q_ret;
 }
 
-#define MSA_TEROP_DF(func) \
-void helper_msa_ ## func ## _df(CPUMIPSState *env, uint32_t df, uint32_t wd,   \
-                          uint32_t ws, uint32_t wt)                     \
+#define MSA_TEROP_DF_E(func, df, e)                                     \
+void helper_msa_ ## func ## _ ## e(CPUMIPSState *env, uint32_t wd,      \
+                                   uint32_t ws, uint32_t wt)            \
 {                                                                       \
     wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                          \
     wr_t *pws = &(env->active_fpu.fpr[ws].wr);                          \
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);                          \
+    wr_t wx;                                                            \
     uint32_t i;                                                         \
                                                                         \
-    switch (df) {                                                       \
-    case DF_BYTE:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_BYTE); i++) {                    \
-            pwd->b[i] = msa_ ## func ## _df(df, pwd->b[i], pws->b[i],   \
-                                            pwt->b[i]);                 \
-        }                                                               \
-        break;                                                          \
-    case DF_HALF:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_HALF); i++) {                    \
-            pwd->h[i] = msa_ ## func ## _df(df, pwd->h[i], pws->h[i],   \
-                                            pwt->h[i]);                 \
-        }                                                               \
-        break;                                                          \
-    case DF_WORD:                                                       \
-        for (i = 0; i < DF_ELEMENTS(DF_WORD); i++) {                    \
-            pwd->w[i] = msa_ ## func ## _df(df, pwd->w[i], pws->w[i],   \
-                                            pwt->w[i]);                 \
-        }                                                               \
-        break;                                                          \
-    case DF_DOUBLE:                                                     \
-        for (i = 0; i < DF_ELEMENTS(DF_DOUBLE); i++) {                  \
-            pwd->d[i] = msa_ ## func ## _df(df, pwd->d[i], pws->d[i],   \
-                                            pwt->d[i]);                 \
-        }                                                               \
-        break;                                                          \
-    default:                                                            \
-        assert(0);                                                      \
+    for (i = 0; i < DF_ELEMENTS(df); i++) {                             \
+        wx.e[i] = msa_ ## func ## _df(df, pwd->e[i], pws->e[i],         \
+                                      pwt->e[i]);                       \
     }                                                                   \
+    *pwd = wx;                                                          \
+}
+
+#define MSA_TEROP_DF(func) \
+MSA_TEROP_DF_E(func, DF_BYTE, b)                                        \
+MSA_TEROP_DF_E(func, DF_HALF, h)                                        \
+MSA_TEROP_DF_E(func, DF_WORD, w)                                        \
+MSA_TEROP_DF_E(func, DF_DOUBLE, d)                                      \
+void helper_msa_ ## func ## _df(CPUMIPSState *env, uint32_t df, uint32_t wd,   \
+                          uint32_t ws, uint32_t wt)                     \
+{                                                                       \
+    MSA_DF_DISPATCH(func, df, env, wd, ws, wt)                          \
 }
 
 MSA_TEROP_DF(maddv)
@@ -1062,6 +1058,7 @@ MSA_TEROP_DF(msub_q)
 MSA_TEROP_DF(maddr_q)
 MSA_TEROP_DF(msubr_q)
 #undef MSA_TEROP_DF
+#undef MSA_TEROP_DF_E
 
 static inline void msa_splat_df(uint32_t df, wr_t *pwd,
                                 wr_t *pws, target_ulong rt)
@@ -2381,6 +2378,150 @@ void helper_msa_fsne_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     (!float ## BITS ## _is_zero(ARG)                \
     && float ## BITS ## _is_zero_or_denormal(ARG))
 
+/*
+ * Host FPU fast path.  With round to nearest, no exception enabled and
+ * flush to zero off, as after reset, an IEEE host FPU computes the same
+ * results as softfloat for everything but NaNs and tiny values, where
+ * NaN propagation and underflow detection differ.  The fast path
+ * computes all the lanes natively and checks the host exception flags
+ * afterwards: Inexact alone is reported in MSACSR directly, anything
+ * else, or a NaN, denormal or smallest normal result, falls back to
+ * softfloat for the whole instruction.
+ */
+#if defined(__x86_64__) || defined(__aarch64__)
+#define MSA_HOST_FPU
+#endif
+
+static inline bool msa_host_fpu_ok(CPUMIPSState *env)
+{
+#ifdef MSA_HOST_FPU
+    return (env->active_tc.msacsr & (MSACSR_RM_MASK | MSACSR_FS_MASK)) == 0 &&
+           GET_FP_ENABLE(env->active_tc.msacsr) == 0;
+#else
+    return false;
+#endif
+}
+
+static inline float msa_host_f32(int32_t a)
+{
+    float f;
+
+    memcpy(&f, &a, sizeof(f));
+    return f;
+}
+
+static inline double msa_host_f64(int64_t a)
+{
+    double f;
+
+    memcpy(&f, &a, sizeof(f));
+    return f;
+}
+
+static inline int32_t msa_host_i32(float f)
+{
+    int32_t a;
+
+    memcpy(&a, &f, sizeof(a));
+    return a;
+}
+
+static inline int64_t msa_host_i64(double f)
+{
+    int64_t a;
+
+    memcpy(&a, &f, sizeof(a));
+    return a;
+}
+
+/* NaN, denormal or smallest normal: leave it to softfloat */
+static inline bool msa_host_special32(int32_t a)
+{
+    uint32_t m = a & 0x7fffffff;
+
+    return m > 0x7f800000 || (m != 0 && m <= 0x00800000);
+}
+
+static inline bool msa_host_special64(int64_t a)
+{
+    uint64_t m = a & ~(1ULL << 63);
+
+    return m > 0x7ff0000000000000ULL ||
+           (m != 0 && m <= 0x0010000000000000ULL);
+}
+
+/*
+ * Define msa_host_<name>(), computing OP32/OP64 of the float lanes A and
+ * B (ws and wt) and the addend D (wd), or of the raw lanes, into wd.
+ * Returns false, leaving wd and MSACSR alone, if softfloat has to do
+ * the work.  Compiler barriers keep the arithmetic between clearing and
+ * testing the host flags: the lanes are read after the first one, and
+ * the second one takes the results as memory operands, so they are all
+ * computed before fetestexcept().
+ */
+#define MSA_HOST_FLOAT_OP(name, OP32, OP64)                                 \
+static bool msa_host_ ## name(CPUMIPSState *env, uint32_t df, uint32_t wd, \
+                              uint32_t ws, uint32_t wt)                     \
+{                                                                           \
+    wr_t *pwd = &(env->active_fpu.fpr[wd].wr);                              \
+    wr_t *pws = &(env->active_fpu.fpr[ws].wr);                              \
+    wr_t *pwt = &(env->active_fpu.fpr[wt].wr);                              \
+    wr_t wx;                                                                \
+    uint32_t i;                                                             \
+    int ex;                                                                 \
+                                                                            \
+    if (!msa_host_fpu_ok(env)) {                                            \
+        return false;                                                       \
+    }                                                                       \
+    feclearexcept(FE_ALL_EXCEPT);                                           \
+    barrier();                                                              \
+    if (df == DF_WORD) {                                                    \
+        for (i = 0; i < DF_ELEMENTS(DF_WORD); i++) {                        \
+            float a = msa_host_f32(pws->w[i]);                              \
+            float b = msa_host_f32(pwt->w[i]);                              \
+            float d = msa_host_f32(pwd->w[i]);                              \
+            wx.w[i] = msa_host_i32(OP32);                                   \
+            (void)a; (void)b; (void)d;                                      \
+        }                                                                   \
+    } else {                                                                \
+        for (i = 0; i < DF_ELEMENTS(DF_DOUBLE); i++) {                      \
+            double a = msa_host_f64(pws->d[i]);                             \
+            double b = msa_host_f64(pwt->d[i]);                             \
+            double d = msa_host_f64(pwd->d[i]);                             \
+            wx.d[i] = msa_host_i64(OP64);                                   \
+            (void)a; (void)b; (void)d;                                      \
+        }                                                                   \
+    }                                                                       \
+    asm volatile("" : "+m"(wx) : : "memory");                               \
+    ex = fetestexcept(FE_ALL_EXCEPT);                                       \
+    if (ex & ~FE_INEXACT) {                                                 \
+        return false;                                                       \
+    }                                                                       \
+    for (i = 0; i < DF_ELEMENTS(df); i++) {                                 \
+        if (df == DF_WORD ? msa_host_special32(wx.w[i])                     \
+                          : msa_host_special64(wx.d[i])) {                  \
+            return false;                                                   \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    SET_FP_CAUSE(env->active_tc.msacsr, ex ? FP_INEXACT : 0);               \
+    UPDATE_FP_FLAGS(env->active_tc.msacsr, ex ? FP_INEXACT : 0);            \
+    pwd->d[0] = wx.d[0];                                                    \
+    pwd->d[1] = wx.d[1];                                                    \
+    return true;                                                            \
+}
+
+MSA_HOST_FLOAT_OP(fadd, a + b, a + b)
+MSA_HOST_FLOAT_OP(fsub, a - b, a - b)
+MSA_HOST_FLOAT_OP(fmul, a * b, a * b)
+MSA_HOST_FLOAT_OP(fdiv, a / b, a / b)
+MSA_HOST_FLOAT_OP(fmadd, fmaf(a, b, d), fma(a, b, d))
+MSA_HOST_FLOAT_OP(fmsub, fmaf(-a, b, d), fma(-a, b, d))
+MSA_HOST_FLOAT_OP(ffint_s, (float)pws->w[i], (double)pws->d[i])
+MSA_HOST_FLOAT_OP(ffint_u, (float)(uint32_t)pws->w[i],
+                  (double)(uint64_t)pws->d[i])
+#undef MSA_HOST_FLOAT_OP
+
 #define MSA_FLOAT_BINOP(DEST, OP, ARG1, ARG2, BITS)                         \
     do {                                                                    \
         float_status *status = &env->active_tc.msa_fp_status;               \
@@ -2404,6 +2545,9 @@ void helper_msa_fadd_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fadd(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -2434,6 +2578,9 @@ void helper_msa_fsub_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fsub(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -2464,6 +2611,9 @@ void helper_msa_fmul_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fmul(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -2495,6 +2645,9 @@ void helper_msa_fdiv_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fdiv(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -2540,6 +2693,9 @@ void helper_msa_fmadd_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fmadd(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -2573,6 +2729,9 @@ void helper_msa_fmsub_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pwt = &(env->active_fpu.fpr[wt].wr);
     uint32_t i;
 
+    if (msa_host_fmsub(env, df, wd, ws, wt)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -3403,6 +3562,9 @@ void helper_msa_ffint_s_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pws = &(env->active_fpu.fpr[ws].wr);
     uint32_t i;
 
+    if (msa_host_ffint_s(env, df, wd, ws, ws)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -3433,6 +3595,9 @@ void helper_msa_ffint_u_df(CPUMIPSState *env, uint32_t df, uint32_t wd,
     wr_t *pws = &(env->active_fpu.fpr[ws].wr);
     uint32_t i;
 
+    if (msa_host_ffint_u(env, df, wd, ws, ws)) {
+        return;
+    }
     clear_msacsr_cause(env);
 
     switch (df) {
@@ -0,0 +1,264 @@
+/*
+ * Online memory access metrics for MSA profiling.
+ *
+ * The metrics of Python_parser/parser_v2.py, computed on the access
+ * records as the trace sink flushes them, so that no log has to be
+ * written and replayed:
+ *
+ *  - accesses to 16-byte aligned and unaligned addresses;
+ *  - accesses per 32-byte block;
+ *  - a histogram of reuse (stack) distances.
+ *
+ * Reuse distances use the Fenwick tree algorithm: every access gets a
+ * timestamp, and the tree holds a 1 at the timestamp of the last access
+ * to every address seen so far.  The distance of an access is then the
+ * number of ones between the previous access to the same address and
+ * now, in O(log n).  When the timestamps run out the live ones are
+ * renumbered densely, which keeps the tree proportional to the number
+ * of distinct addresses rather than the length of the run.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "msa_metrics.h"
+
+#define ADDR_MAP_MIN_BITS   12
+#define FENWICK_MIN_SIZE    (1 << 16)
+
+/* Open addressing hash map from a 64-bit key to a 64-bit value */
+typedef struct AddrMap {
+    uint64_t *keys;             /* key + 1, 0 marks a free slot */
+    uint64_t *vals;
+    unsigned bits;
+    size_t used;
+} AddrMap;
+
+struct MSAMetrics {
+    uint64_t accesses;
+    uint64_t aligned;
+    AddrMap blocks;             /* 32-byte block -> accesses */
+    AddrMap last_use;           /* address -> timestamp of last access */
+    uint32_t *fenwick;          /* indexed 1..fenwick_size */
+    size_t fenwick_size;
+    size_t now;                 /* timestamp of the next access */
+    uint64_t cold;              /* first accesses, no reuse distance */
+    uint64_t reuse[MSA_METRICS_REUSE_BUCKETS];
+};
+
+static void addr_map_init(AddrMap *map, unsigned bits)
+{
+    map->bits = bits;
+    map->used = 0;
+    map->keys = g_new0(uint64_t, 1ULL << bits);
+    map->vals = g_new0(uint64_t, 1ULL << bits);
+}
+
+static void addr_map_destroy(AddrMap *map)
+{
+    g_free(map->keys);
+    g_free(map->vals);
+}
+
+static inline size_t addr_map_hash(AddrMap *map, uint64_t key)
+{
+    return (key * 0x9e3779b97f4a7c15ULL) >> (64 - map->bits);
+}
+
+/*
+ * Return the value slot of @key, inserting it with a zero value if it
+ * is absent; *@found tells which.  The slot stays valid until the next
+ * insertion.
+ */
+static uint64_t *addr_map_get(AddrMap *map, uint64_t key, bool *found)
+{
+    size_t mask = (1ULL << map->bits) - 1;
+    size_t i;
+
+    if (map->used * 2 >= mask) {
+        AddrMap old = *map;
+
+        addr_map_init(map, old.bits + 1);
+        for (i = 0; i <= mask; i++) {
+            if (old.keys[i]) {
+                *addr_map_get(map, old.keys[i] - 1, found) = old.vals[i];
+            }
+        }
+        addr_map_destroy(&old);
+        mask = (1ULL << map->bits) - 1;
+    }
+
+    for (i = addr_map_hash(map, key); ; i = (i + 1) & mask) {
+        if (map->keys[i] == key + 1) {
+            *found = true;
+            return &map->vals[i];
+        }
+        if (!map->keys[i]) {
+            map->keys[i] = key + 1;
+            map->used++;
+            *found = false;
+            return &map->vals[i];
+        }
+    }
+}
+
+static void fenwick_add(MSAMetrics *m, size_t i, int v)
+{
+    for (; i <= m->fenwick_size; i += i & -i) {
+        m->fenwick[i] += v;
+    }
+}
+
+static uint64_t fenwick_sum(MSAMetrics *m, size_t i)
+{
+    uint64_t sum = 0;
+
+    for (; i; i -= i & -i) {
+        sum += m->fenwick[i];
+    }
+    return sum;
+}
+
+static int cmp_u64_ptr(const void *a, const void *b)
+{
+    uint64_t x = **(uint64_t * const *)a;
+    uint64_t y = **(uint64_t * const *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Renumber the last access of every address as 1..n in the same order
+ * and rebuild the tree with room for at least n more accesses.
+ */
+static void msa_metrics_compact(MSAMetrics *m)
+{
+    AddrMap *map = &m->last_use;
+    size_t n = map->used;
+    size_t size = (size_t)1 << map->bits;
+    uint64_t **live = g_new(uint64_t *, n);
+    size_t i, j;
+
+    for (i = 0, j = 0; i < size; i++) {
+        if (map->keys[i]) {
+            live[j++] = &map->vals[i];
+        }
+    }
+    qsort(live, n, sizeof(*live), cmp_u64_ptr);
+
+    m->fenwick_size = MAX(m->fenwick_size, 2 * n);
+    g_free(m->fenwick);
+    m->fenwick = g_new0(uint32_t, m->fenwick_size + 1);
+    for (i = 0; i < n; i++) {
+        *live[i] = i + 1;
+        fenwick_add(m, i + 1, 1);
+    }
+    m->now = n + 1;
+    g_free(live);
+}
+
+MSAMetrics *msa_metrics_new(void)
+{
+    MSAMetrics *m = g_new0(MSAMetrics, 1);
+
+    addr_map_init(&m->blocks, ADDR_MAP_MIN_BITS);
+    addr_map_init(&m->last_use, ADDR_MAP_MIN_BITS);
+    m->fenwick_size = FENWICK_MIN_SIZE;
+    m->fenwick = g_new0(uint32_t, m->fenwick_size + 1);
+    m->now = 1;
+    return m;
+}
+
+void msa_metrics_free(MSAMetrics *m)
+{
+    addr_map_destroy(&m->blocks);
+    addr_map_destroy(&m->last_use);
+    g_free(m->fenwick);
+    g_free(m);
+}
+
+static void msa_metrics_access(MSAMetrics *m, uint64_t addr)
+{
+    uint64_t *last;
+    uint64_t dist;
+    bool found;
+    size_t t;
+
+    m->accesses++;
+    if (addr % MSA_METRICS_ALIGN == 0) {
+        m->aligned++;
+    }
+    (*addr_map_get(&m->blocks, addr >> MSA_METRICS_BLOCK_SHIFT, &found))++;
+
+    if (m->now > m->fenwick_size) {
+        msa_metrics_compact(m);
+    }
+    t = m->now++;
+    last = addr_map_get(&m->last_use, addr, &found);
+    if (found) {
+        dist = fenwick_sum(m, t - 1) - fenwick_sum(m, *last);
+        fenwick_add(m, *last, -1);
+        m->reuse[dist ? 64 - clz64(dist) : 0]++;
+    } else {
+        m->cold++;
+    }
+    fenwick_add(m, t, 1);
+    *last = t;
+}
+
+void msa_metrics_add(MSAMetrics *m, const uint64_t *records, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        msa_metrics_access(m, MSA_TRACE_REC_ADDR(records[i]));
+    }
+}
+
+/* Write the summary as a JSON object */
+void msa_metrics_write(MSAMetrics *m, FILE *f,
+                       uint64_t msa_ops, uint64_t msa_ldst)
+{
+    AddrMap *map = &m->blocks;
+    size_t size = (size_t)1 << map->bits;
+    uint64_t **blocks = g_new(uint64_t *, map->used);
+    size_t i, j;
+    int last;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"msa_ops\": %" PRIu64 ",\n", msa_ops);
+    fprintf(f, "  \"msa_ldst\": %" PRIu64 ",\n", msa_ldst);
+    fprintf(f, "  \"accesses\": %" PRIu64 ",\n", m->accesses);
+    fprintf(f, "  \"aligned16\": %" PRIu64 ",\n", m->aligned);
+    fprintf(f, "  \"unaligned16\": %" PRIu64 ",\n", m->accesses - m->aligned);
+
+    /* Sort by block number, as space_localization_metric does */
+    for (i = 0, j = 0; i < size; i++) {
+        if (map->keys[i]) {
+            blocks[j++] = &map->keys[i];
+        }
+    }
+    qsort(blocks, j, sizeof(*blocks), cmp_u64_ptr);
+    fprintf(f, "  \"blocks32\": [");
+    for (i = 0; i < j; i++) {
+        fprintf(f, "%s[%" PRIu64 ", %" PRIu64 "]", i ? ", " : "",
+                *blocks[i] - 1, map->vals[blocks[i] - map->keys]);
+    }
+    fprintf(f, "],\n");
+    g_free(blocks);
+
+    fprintf(f, "  \"reuse_cold\": %" PRIu64 ",\n", m->cold);
+    for (last = MSA_METRICS_REUSE_BUCKETS - 1; last > 0; last--) {
+        if (m->reuse[last]) {
+            break;
+        }
+    }
+    fprintf(f, "  \"reuse_log2\": [");
+    for (i = 0; i <= (size_t)last; i++) {
+        fprintf(f, "%s%" PRIu64, i ? ", " : "", m->reuse[i]);
+    }
+    fprintf(f, "]\n}\n");
+}
@@ -0,0 +1,30 @@
+/*
+ * Online memory access metrics for MSA profiling.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef MIPS_MSA_METRICS_H
+#define MIPS_MSA_METRICS_H
+
+/* Granularity of the alignment count and of the spatial histogram */
+#define MSA_METRICS_ALIGN       16
+#define MSA_METRICS_BLOCK_SHIFT 5
+
+/*
+ * Reuse distance histogram: bucket 0 counts immediate reuse, bucket i
+ * counts distances in [2^(i-1), 2^i), where the distance is the number
+ * of distinct other addresses accessed since the previous access.
+ */
+#define MSA_METRICS_REUSE_BUCKETS 64
+
+typedef struct MSAMetrics MSAMetrics;
+
+MSAMetrics *msa_metrics_new(void);
+void msa_metrics_free(MSAMetrics *m);
+void msa_metrics_add(MSAMetrics *m, const uint64_t *records, size_t count);
+void msa_metrics_write(MSAMetrics *m, FILE *f,
+                       uint64_t msa_ops, uint64_t msa_ldst);
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Cycle-approximate timing model for MSA profiling.
+ *
+ * Every traced block is scheduled once, when it is translated, on a
+ * single-issue in-order pipeline: an instruction issues when the
+ * previous one has left the issue stage and all its source registers
+ * are ready, and its results become ready after the latency of the
+ * opcode.  Registers are assumed ready at block entry, so dependencies
+ * across blocks and cache misses are not modelled; the block profile
+ * multiplies the result by the execution count of the block.
+ *
+ * Latencies and repeat rates approximate the I6400 scalar pipes and MSA
+ * unit.  They are good enough to rank code variants and compiler flags,
+ * not to predict absolute run times.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cutils.h"
+#include "cpu.h"
+#include "msa_timing.h"
+
+typedef struct MSATimingOp {
+    const char *prefix;
+    uint8_t latency;
+    uint8_t repeat;             /* cycles before the next issue */
+} MSATimingOp;
+
+/* Looked up by name prefix, the first match wins */
+static const MSATimingOp msa_timing_ops[] = {
+    /* MSA unit */
+    { "MSA_LD_",      5,  1 },
+    { "MSA_ST_",      1,  1 },
+    { "MSA_FDIV",    24, 20 },
+    { "MSA_FSQRT",   24, 20 },
+    { "MSA_FRCP",    10,  4 },
+    { "MSA_FRSQRT",  10,  4 },
+    { "MSA_FMADD",    8,  1 },
+    { "MSA_FMSUB",    8,  1 },
+    { "MSA_FCLASS",   2,  1 },
+    { "MSA_FILL",     3,  1 },      /* the one integer MSA_F* opcode */
+    { "MSA_F",        4,  1 },
+    { "MSA_DIV_",    36, 32 },
+    { "MSA_MOD_",    36, 32 },
+    { "MSA_MULV",     5,  1 },
+    { "MSA_MADDV",    5,  1 },
+    { "MSA_MSUBV",    5,  1 },
+    { "MSA_DOTP",     5,  1 },
+    { "MSA_DPADD",    5,  1 },
+    { "MSA_DPSUB",    5,  1 },
+    { "MSA_MUL",      5,  1 },
+    { "MSA_MADD",     5,  1 },
+    { "MSA_MSUB",     5,  1 },
+    { "MSA_COPY_",    3,  1 },
+    { "MSA_INSERT",   3,  1 },
+    { "MSA_",         2,  1 },
+    /* Scalar pipes */
+    { "DIV_",        17, 14 },
+    { "SQRT_",       17, 14 },
+    { "RECIP",       17, 14 },
+    { "RSQRT",       17, 14 },
+    { "DIV",         24, 24 },
+    { "DDIV",        40, 40 },
+    { "MOD",         24, 24 },
+    { "DMOD",        40, 40 },
+    { "MUL",          4,  1 },
+    { "DMUL",         5,  1 },
+    { "MADD",         4,  1 },
+    { "MSUB",         4,  1 },
+};
+
+/* Defaults per instruction class */
+static const MSATimingOp msa_timing_class_ops[MSA_TRACE_NR_CLASSES] = {
+    [MSA_TRACE_CLASS_ALU]      = { NULL, 1, 1 },
+    [MSA_TRACE_CLASS_LDST]     = { NULL, 3, 1 },
+    [MSA_TRACE_CLASS_MSA]      = { NULL, 2, 1 },
+    [MSA_TRACE_CLASS_MSA_LDST] = { NULL, 5, 1 },
+    [MSA_TRACE_CLASS_BRANCH]   = { NULL, 1, 1 },
+};
+
+#define MAX_OPERANDS 4
+
+typedef struct MSATimingOperands {
+    int nr_src, nr_dst;
+    uint8_t src[MAX_OPERANDS];
+    uint8_t dst[MAX_OPERANDS];
+} MSATimingOperands;
+
+static void add_src(MSATimingOperands *o, int reg)
+{
+    if (reg != MSA_TIMING_GPR && o->nr_src < MAX_OPERANDS) {
+        o->src[o->nr_src++] = reg;
+    }
+}
+
+static void add_dst(MSATimingOperands *o, int reg)
+{
+    if (reg != MSA_TIMING_GPR && o->nr_dst < MAX_OPERANDS) {
+        o->dst[o->nr_dst++] = reg;
+    }
+}
+
+/* MSA instructions that also read their destination */
+static bool msa_reads_wd(const char *name)
+{
+    static const char *const acc[] = {
+        "DPADD", "DPSUB", "MADD", "MSUB", "BINS", "BMNZ", "BMZ", "BSEL",
+        "VSHF", "SLD", "INSERT", "INSVE",
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(acc); i++) {
+        if (strstr(name, acc[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void msa_timing_msa_operands(MSATimingOperands *o, uint32_t insn,
+                                    const char *name)
+{
+    int wt = MSA_TIMING_WR + ((insn >> 16) & 0x1f);
+    int ws = MSA_TIMING_WR + ((insn >> 11) & 0x1f);
+    int wd = MSA_TIMING_WR + ((insn >> 6) & 0x1f);
+    int minor = insn & 0x3f;
+
+    if (minor >= 0x20 && minor <= 0x27) {
+        /* MI10 loads and stores: base GPR in the ws field */
+        add_src(o, MSA_TIMING_GPR + ((insn >> 11) & 0x1f));
+        if (minor < 0x24) {
+            add_dst(o, wd);
+        } else {
+            add_src(o, wd);
+        }
+        return;
+    }
+    if (strstr(name, "COPY_") || strstr(name, "CFCMSA")) {
+        /* Vector element to GPR: GPR number in the wd field */
+        add_src(o, ws);
+        add_dst(o, MSA_TIMING_GPR + ((insn >> 6) & 0x1f));
+        return;
+    }
+    if (strstr(name, "INSERT") || strstr(name, "FILL") ||
+        strstr(name, "CTCMSA")) {
+        add_src(o, MSA_TIMING_GPR + ((insn >> 11) & 0x1f));
+    } else if (!strstr(name, "LDI")) {
+        add_src(o, ws);
+    }
+    /* 3R, 3RF and VEC formats have a wt operand */
+    if ((minor >= 0x0d && minor <= 0x15) ||
+        (minor >= 0x1a && minor <= 0x1c) ||
+        (minor == 0x1e && ((insn >> 21) & 0x1f) < 0x18)) {
+        add_src(o, wt);
+    }
+    if (msa_reads_wd(name)) {
+        add_src(o, wd);
+    }
+    add_dst(o, wd);
+}
+
+/*
+ * Registers read and written by a 32-bit MIPS instruction.  Unusual
+ * encodings fall back to "reads rs and rt, writes rd", which can both
+ * add false dependencies and miss real ones, so the estimate is only
+ * as good as the decoding below.
+ */
+static void msa_timing_operands(MSATimingOperands *o, uint32_t insn,
+                                const char *name)
+{
+    int op = insn >> 26;
+    int rs = (insn >> 21) & 0x1f;
+    int rt = (insn >> 16) & 0x1f;
+    int rd = (insn >> 11) & 0x1f;
+    int sa = (insn >> 6) & 0x1f;
+    int funct = insn & 0x3f;
+
+    o->nr_src = o->nr_dst = 0;
+    switch (op) {
+    case 0x00: /* SPECIAL */
+        if (funct == 0x08 || funct == 0x09) {           /* JR, JALR */
+            add_src(o, rs);
+            add_dst(o, rd);
+        } else if (funct == 0x10 || funct == 0x12) {    /* MFHI, MFLO */
+            add_src(o, MSA_TIMING_HILO);
+            add_dst(o, rd);
+        } else if (funct == 0x11 || funct == 0x13) {    /* MTHI, MTLO */
+            add_src(o, rs);
+            add_dst(o, MSA_TIMING_HILO);
+        } else if (funct >= 0x18 && funct <= 0x1f) {    /* MULT, DIV, ... */
+            add_src(o, rs);
+            add_src(o, rt);
+            add_dst(o, rd);
+            add_dst(o, MSA_TIMING_HILO);
+        } else {
+            add_src(o, rs);
+            add_src(o, rt);
+            add_dst(o, rd);
+        }
+        break;
+    case 0x01: /* REGIMM */
+        add_src(o, rs);
+        add_dst(o, 31);
+        break;
+    case 0x02: /* J */
+        break;
+    case 0x03: /* JAL */
+        add_dst(o, 31);
+        break;
+    case 0x04 ... 0x07: /* BEQ, BNE, BLEZ, BGTZ and R6 compact branches */
+    case 0x14 ... 0x17:
+        add_src(o, rs);
+        add_src(o, rt);
+        break;
+    case 0x0f: /* LUI */
+        add_dst(o, rt);
+        break;
+    case 0x11: /* COP1 */
+        if (rs == 0x00 || rs == 0x01 || rs == 0x03) {   /* MFC1, MFHC1 */
+            add_src(o, MSA_TIMING_WR + rd);
+            add_dst(o, rt);
+        } else if (rs == 0x04 || rs == 0x05 || rs == 0x07) { /* MTC1 */
+            add_src(o, rt);
+            add_dst(o, MSA_TIMING_WR + rd);
+        } else if (rs == 0x08 || rs == 0x09 || rs == 0x0b || rs == 0x0d ||
+                   rs == 0x0f || rs >= 0x18) {          /* branches */
+            add_src(o, MSA_TIMING_WR + rt);
+        } else {                                        /* arithmetic */
+            add_src(o, MSA_TIMING_WR + rd);
+            add_src(o, MSA_TIMING_WR + rt);
+            add_dst(o, MSA_TIMING_WR + sa);
+        }
+        break;
+    case 0x13: /* COP1X */
+        if (funct >= 0x20) {                            /* MADD, MSUB, ... */
+            add_src(o, MSA_TIMING_WR + rs);
+            add_src(o, MSA_TIMING_WR + rt);
+            add_src(o, MSA_TIMING_WR + rd);
+            add_dst(o, MSA_TIMING_WR + sa);
+        } else if (funct == 0x1e) {                     /* ALNV.PS */
+            add_src(o, rs);
+            add_src(o, MSA_TIMING_WR + rt);
+            add_src(o, MSA_TIMING_WR + rd);
+            add_dst(o, MSA_TIMING_WR + sa);
+        } else if (funct == 0x08 || funct == 0x09 || funct == 0x0d) {
+            add_src(o, rs);                             /* SWXC1, SDXC1 */
+            add_src(o, rt);
+            add_src(o, MSA_TIMING_WR + rd);
+        } else if (funct == 0x0f) {                     /* PREFX */
+            add_src(o, rs);
+            add_src(o, rt);
+        } else {                                        /* LWXC1, LDXC1 */
+            add_src(o, rs);
+            add_src(o, rt);
+            add_dst(o, MSA_TIMING_WR + sa);
+        }
+        break;
+    case 0x1e: /* MSA */
+        msa_timing_msa_operands(o, insn, name);
+        break;
+    case 0x1f: /* SPECIAL3 */
+        if (funct == 0x20 || funct == 0x24) {           /* BSHFL, DBSHFL */
+            add_src(o, rt);
+            add_dst(o, rd);
+        } else {
+            add_src(o, rs);
+            add_src(o, rt);
+            add_dst(o, rt);
+        }
+        break;
+    case 0x31: /* LWC1 */
+    case 0x35: /* LDC1 */
+        add_src(o, rs);
+        add_dst(o, MSA_TIMING_WR + rt);
+        break;
+    case 0x39: /* SWC1 */
+    case 0x3d: /* SDC1 */
+        add_src(o, rs);
+        add_src(o, MSA_TIMING_WR + rt);
+        break;
+    case 0x28 ... 0x2e: /* stores */
+    case 0x3f:
+        add_src(o, rs);
+        add_src(o, rt);
+        break;
+    case 0x38: /* SC, SCD */
+    case 0x3c:
+        add_src(o, rs);
+        add_src(o, rt);
+        add_dst(o, rt);
+        break;
+    default: /* immediate arithmetic and loads */
+        add_src(o, rs);
+        add_dst(o, rt);
+        break;
+    }
+}
+
+void msa_timing_reset(MSATiming *t)
+{
+    memset(t, 0, sizeof(*t));
+}
+
+/* Schedule one instruction of class @cls; @name may be NULL */
+void msa_timing_insn(MSATiming *t, uint32_t insn, const char *name,
+                     unsigned cls)
+{
+    const MSATimingOp *op = &msa_timing_class_ops[cls];
+    MSATimingOperands o;
+    uint32_t issue = t->clock;
+    int i;
+
+    if (name) {
+        for (i = 0; i < ARRAY_SIZE(msa_timing_ops); i++) {
+            if (strstart(name, msa_timing_ops[i].prefix, NULL)) {
+                op = &msa_timing_ops[i];
+                break;
+            }
+        }
+    }
+    msa_timing_operands(&o, insn, name ? name : "");
+
+    for (i = 0; i < o.nr_src; i++) {
+        issue = MAX(issue, t->ready[o.src[i]]);
+    }
+    t->clock = issue + op->repeat;
+    for (i = 0; i < o.nr_dst; i++) {
+        t->ready[o.dst[i]] = issue + op->latency;
+    }
+}
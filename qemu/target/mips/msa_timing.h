@@ -0,0 +1,26 @@
+/*
+ * Cycle-approximate timing model for MSA profiling.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef MIPS_MSA_TIMING_H
+#define MIPS_MSA_TIMING_H
+
+/* Scoreboard entries: GPRs, FPU/MSA registers, then HI/LO */
+#define MSA_TIMING_GPR          0
+#define MSA_TIMING_WR           32
+#define MSA_TIMING_HILO         64
+#define MSA_TIMING_NR_REGS      65
+
+typedef struct MSATiming {
+    uint32_t clock;                         /* next free issue cycle */
+    uint32_t ready[MSA_TIMING_NR_REGS];     /* cycle the value is ready */
+} MSATiming;
+
+void msa_timing_reset(MSATiming *t);
+void msa_timing_insn(MSATiming *t, uint32_t insn, const char *name,
+                     unsigned cls);
+
+#endif
@@ -0,0 +1,715 @@
+/*
+ * MIPS instruction trace sink for MSA profiling.
+ *
+ * The trace file is opened once per process.  Every vCPU owns a buffer
+ * of memory access records, filled directly by the generated code
+ * through env->trace_pos and appended to the file in one write()
+ * whenever it runs short of space, and when the vCPU or the process
+ * exits.  Execution counts live in each vCPU's CPUMIPSState and are
+ * folded into the opcode table when a vCPU exits and when the trace is
+ * closed.
+ *
+ * Flushed records can also be fed to the online metrics of
+ * msa_metrics.c and to the cache model of msa_cache.c, with or without
+ * a trace file.
+ *
+ * The block profile counts executions of every traced TB and, at exit,
+ * writes a report of the hottest blocks and functions with their
+ * instruction mix, symbolized through the guest ELF symbol table.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "cpu.h"
+#include "exec/helper-proto.h"
+#include "disas/disas.h"
+#include "msa_trace.h"
+#include "msa_metrics.h"
+#include "msa_cache.h"
+
+struct MSATraceBuffer {
+    uint64_t records[MSA_TRACE_BUF_RECORDS];
+};
+
+static struct {
+    QemuMutex lock;
+    bool enabled;
+    int fd;
+    MSAMetrics *metrics;
+    char *metrics_file;
+    MSACache *cache;
+    char *cache_file;
+    uint64_t nr_records;
+    GHashTable *opcode_ids;
+    MSATraceOpcode opcodes[MSA_TRACE_MAX_OPCODES];
+    int nr_opcodes;
+    GHashTable *site_ids;
+    uint64_t site_keys[MSA_TRACE_MAX_SITES];
+    MSATraceSite sites[MSA_TRACE_MAX_SITES];
+    int nr_sites;
+    char *profile_file;
+    GHashTable *block_ids;
+    MSATraceBlock *blocks[MSA_TRACE_MAX_BLOCKS / MSA_TRACE_BLOCK_CHUNK];
+    int nr_blocks;
+    bool roi_set;
+    uint64_t roi_start;
+    uint64_t roi_end;
+} msa_trace = {
+    .fd = -1,
+    .roi_start = MSA_TRACE_ROI_NONE,
+    .roi_end = MSA_TRACE_ROI_NONE,
+};
+
+static void msa_trace_write_header(void)
+{
+    MSATraceHeader hdr;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MSA_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = MSA_TRACE_VERSION;
+    hdr.header_size = sizeof(MSATraceHeader);
+    hdr.record_size = sizeof(uint64_t);
+    hdr.opcode_size = sizeof(MSATraceOpcode);
+    hdr.site_size = sizeof(MSATraceSite);
+    hdr.nr_records = msa_trace.nr_records;
+    if (msa_trace.nr_records || msa_trace.nr_opcodes) {
+        hdr.sites_offset = sizeof(MSATraceHeader) +
+                           msa_trace.nr_records * sizeof(uint64_t);
+        hdr.opcodes_offset = hdr.sites_offset +
+                             msa_trace.nr_sites * sizeof(MSATraceSite);
+    }
+    hdr.nr_opcodes = msa_trace.nr_opcodes;
+    hdr.nr_sites = msa_trace.nr_sites;
+
+    if (pwrite(msa_trace.fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+        error_report("msa-trace: failed to write header: %s",
+                     strerror(errno));
+    }
+}
+
+/*
+ * Start tracing to @filename, computing the metrics summary written to
+ * @metrics_filename at exit, and/or profiling blocks for the report
+ * written to @profile_filename at exit, and/or simulating the data
+ * cache as described by @cache_arg, "file[,options]" (see msa_cache.c).
+ * Any of them may be NULL.
+ */
+void msa_trace_open(const char *filename, const char *metrics_filename,
+                    const char *profile_filename, const char *cache_arg)
+{
+    const char *p;
+    int fd;
+
+    if (!filename && !metrics_filename && !profile_filename && !cache_arg) {
+        return;
+    }
+
+    if (filename) {
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            error_report("msa-trace: cannot open '%s': %s",
+                         filename, strerror(errno));
+            exit(1);
+        }
+        msa_trace.fd = fd;
+        msa_trace.nr_records = 0;
+        msa_trace_write_header();
+        /*
+         * The header is rewritten in place by pwrite() at exit, which
+         * O_APPEND would redirect to the end: records follow it instead.
+         */
+        if (lseek(fd, sizeof(MSATraceHeader), SEEK_SET) < 0) {
+            error_report("msa-trace: cannot seek '%s': %s",
+                         filename, strerror(errno));
+            exit(1);
+        }
+    }
+    if (metrics_filename) {
+        msa_trace.metrics = msa_metrics_new();
+        msa_trace.metrics_file = g_strdup(metrics_filename);
+    }
+    if (profile_filename) {
+        msa_trace.profile_file = g_strdup(profile_filename);
+    }
+    if (cache_arg) {
+        p = strchr(cache_arg, ',');
+        msa_trace.cache = msa_cache_new(p ? p + 1 : "", msa_trace.sites,
+                                        msa_trace.opcodes);
+        if (!msa_trace.cache) {
+            exit(1);
+        }
+        msa_trace.cache_file = p ? g_strndup(cache_arg, p - cache_arg)
+                                 : g_strdup(cache_arg);
+    }
+
+    qemu_mutex_init(&msa_trace.lock);
+    msa_trace.enabled = true;
+    atexit(msa_trace_close);
+}
+
+bool msa_trace_enabled(void)
+{
+    return msa_trace.enabled;
+}
+
+/* Must be called with msa_trace.lock held */
+static void msa_trace_flush_locked(CPUMIPSState *env)
+{
+    uint64_t *records = env->trace_buf->records;
+    size_t count = env->trace_pos - records;
+    size_t len = count * sizeof(uint64_t);
+
+    env->trace_pos = records;
+    if (count == 0) {
+        return;
+    }
+    if (msa_trace.metrics) {
+        msa_metrics_add(msa_trace.metrics, records, count);
+    }
+    if (msa_trace.cache) {
+        msa_cache_add(msa_trace.cache, records, count);
+    }
+    if (msa_trace.fd < 0) {
+        return;
+    }
+    if (write(msa_trace.fd, records, len) != len) {
+        error_report("msa-trace: short write, trace truncated: %s",
+                     strerror(errno));
+        close(msa_trace.fd);
+        msa_trace.fd = -1;
+    } else {
+        msa_trace.nr_records += count;
+    }
+}
+
+/* Must be called with msa_trace.lock held */
+static void msa_trace_add_counts_locked(CPUMIPSState *env)
+{
+    int i;
+
+    for (i = 0; i < msa_trace.nr_opcodes; i++) {
+        msa_trace.opcodes[i].count += env->trace_counts[i];
+        env->trace_counts[i] = 0;
+    }
+}
+
+/* Must be called with msa_trace.lock held */
+static void msa_trace_write_metrics_locked(void)
+{
+    uint64_t msa_ops = 0, msa_ldst = 0;
+    MSATraceOpcode *op;
+    FILE *f;
+    int i;
+
+    f = fopen(msa_trace.metrics_file, "w");
+    if (!f) {
+        error_report("msa-trace: cannot open '%s': %s",
+                     msa_trace.metrics_file, strerror(errno));
+        return;
+    }
+    /*
+     * Same split as msa_metric in parser_v2.py, but by the access flags:
+     * matching "LD"/"ST" in the name also caught LDI, SLD and SLDI.
+     */
+    for (i = 0; i < msa_trace.nr_opcodes; i++) {
+        op = &msa_trace.opcodes[i];
+        if (!(op->flags & MSA_TRACE_F_MSA)) {
+            continue;
+        }
+        if (op->flags & MSA_TRACE_F_LDST) {
+            msa_ldst += op->count;
+        } else {
+            msa_ops += op->count;
+        }
+    }
+    msa_metrics_write(msa_trace.metrics, f, msa_ops, msa_ldst);
+    fclose(f);
+}
+
+/* Must be called with msa_trace.lock held */
+static void msa_trace_write_cache_locked(void)
+{
+    FILE *f;
+
+    f = fopen(msa_trace.cache_file, "w");
+    if (!f) {
+        error_report("msa-trace: cannot open '%s': %s",
+                     msa_trace.cache_file, strerror(errno));
+        return;
+    }
+    msa_cache_write(msa_trace.cache, f, msa_trace.nr_sites);
+    fclose(f);
+}
+
+static inline MSATraceBlock *msa_trace_block_at(int id)
+{
+    return &msa_trace.blocks[id / MSA_TRACE_BLOCK_CHUNK]
+                            [id % MSA_TRACE_BLOCK_CHUNK];
+}
+
+static inline uint64_t msa_trace_block_weight(const MSATraceBlock *b)
+{
+    return b->count * b->insns;
+}
+
+static inline uint64_t msa_trace_block_cycles(const MSATraceBlock *b)
+{
+    return b->count * b->cycles;
+}
+
+static int msa_trace_block_cmp(const void *a, const void *b)
+{
+    uint64_t x = msa_trace_block_cycles(*(MSATraceBlock * const *)a);
+    uint64_t y = msa_trace_block_cycles(*(MSATraceBlock * const *)b);
+
+    return x > y ? -1 : x < y;
+}
+
+typedef struct MSATraceFunc {
+    const char *name;
+    uint64_t insns;
+    uint64_t cycles;
+    uint64_t mix[MSA_TRACE_NR_CLASSES];
+} MSATraceFunc;
+
+static int msa_trace_func_cmp(const void *a, const void *b)
+{
+    uint64_t x = (*(MSATraceFunc * const *)a)->cycles;
+    uint64_t y = (*(MSATraceFunc * const *)b)->cycles;
+
+    return x > y ? -1 : x < y;
+}
+
+static double msa_trace_share(const uint64_t *mix, uint64_t insns)
+{
+    uint64_t msa = mix[MSA_TRACE_CLASS_MSA] + mix[MSA_TRACE_CLASS_MSA_LDST];
+
+    return insns ? 100.0 * msa / insns : 0;
+}
+
+static void msa_trace_print_mix(FILE *f, const uint64_t *mix, uint64_t insns,
+                                uint64_t cycles)
+{
+    int i;
+
+    fprintf(f, " %5.2f", insns ? (double)cycles / insns : 0);
+    for (i = 0; i < MSA_TRACE_NR_CLASSES; i++) {
+        fprintf(f, " %12" PRIu64, mix[i]);
+    }
+    fprintf(f, " %6.1f", msa_trace_share(mix, insns));
+}
+
+/*
+ * Write the hot block report, blocks and then functions sorted by the
+ * cycles they took in the timing model (msa_timing.c).  Counts are
+ * dynamic: the static mix and cycles of a block times its executions.
+ */
+static void msa_trace_write_profile(void)
+{
+    static const char header[] = "   cpi          alu         ldst          msa"
+                                 "     msa_ldst       branch   msa%";
+    MSATraceBlock **blocks;
+    MSATraceFunc **funcs;
+    GHashTable *func_ids;
+    MSATraceFunc *fn;
+    uint64_t mix[MSA_TRACE_NR_CLASSES];
+    int nr_funcs = 0;
+    FILE *f;
+    int i, j;
+
+    f = fopen(msa_trace.profile_file, "w");
+    if (!f) {
+        error_report("msa-trace: cannot open '%s': %s",
+                     msa_trace.profile_file, strerror(errno));
+        return;
+    }
+
+    blocks = g_new(MSATraceBlock *, msa_trace.nr_blocks);
+    funcs = g_new(MSATraceFunc *, msa_trace.nr_blocks);
+    func_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < msa_trace.nr_blocks; i++) {
+        MSATraceBlock *b = msa_trace_block_at(i);
+        const char *name = lookup_symbol(b->pc);
+
+        blocks[i] = b;
+        if (!name[0]) {
+            name = "?";
+        }
+        fn = g_hash_table_lookup(func_ids, name);
+        if (!fn) {
+            fn = g_new0(MSATraceFunc, 1);
+            fn->name = name;
+            funcs[nr_funcs++] = fn;
+            g_hash_table_insert(func_ids, (gpointer)name, fn);
+        }
+        fn->insns += msa_trace_block_weight(b);
+        fn->cycles += msa_trace_block_cycles(b);
+        for (j = 0; j < MSA_TRACE_NR_CLASSES; j++) {
+            fn->mix[j] += b->count * b->mix[j];
+        }
+    }
+    qsort(blocks, msa_trace.nr_blocks, sizeof(*blocks), msa_trace_block_cmp);
+    qsort(funcs, nr_funcs, sizeof(*funcs), msa_trace_func_cmp);
+
+    fprintf(f, "Hot blocks\n\n");
+    fprintf(f, "                pc        execs insns cycles    dyn_insns"
+               "   dyn_cycles%s  function\n", header);
+    for (i = 0; i < msa_trace.nr_blocks; i++) {
+        MSATraceBlock *b = blocks[i];
+        const char *name = lookup_symbol(b->pc);
+
+        if (!b->count) {
+            break;
+        }
+        for (j = 0; j < MSA_TRACE_NR_CLASSES; j++) {
+            mix[j] = b->count * b->mix[j];
+        }
+        fprintf(f, "0x%016" PRIx64 " %12" PRIu64 " %5u %6u %12" PRIu64
+                " %12" PRIu64, b->pc, b->count, b->insns, b->cycles,
+                msa_trace_block_weight(b), msa_trace_block_cycles(b));
+        msa_trace_print_mix(f, mix, msa_trace_block_weight(b),
+                            msa_trace_block_cycles(b));
+        fprintf(f, "  %s\n", name[0] ? name : "?");
+    }
+
+    fprintf(f, "\nFunctions\n\n");
+    fprintf(f, "   dyn_insns   dyn_cycles%s  function\n", header);
+    for (i = 0; i < nr_funcs; i++) {
+        fn = funcs[i];
+        if (fn->insns) {
+            fprintf(f, "%12" PRIu64 " %12" PRIu64, fn->insns, fn->cycles);
+            msa_trace_print_mix(f, fn->mix, fn->insns, fn->cycles);
+            fprintf(f, "  %s\n", fn->name);
+        }
+        g_free(fn);
+    }
+
+    g_hash_table_destroy(func_ids);
+    g_free(funcs);
+    g_free(blocks);
+    fclose(f);
+}
+
+void msa_trace_close(void)
+{
+    CPUState *cs;
+    size_t len;
+
+    if (!msa_trace.enabled) {
+        return;
+    }
+
+    qemu_mutex_lock(&msa_trace.lock);
+    CPU_FOREACH(cs) {
+        CPUMIPSState *env = &MIPS_CPU(cs)->env;
+
+        if (env->trace_buf) {
+            msa_trace_flush_locked(env);
+        }
+        msa_trace_add_counts_locked(env);
+    }
+    if (msa_trace.fd >= 0) {
+        len = msa_trace.nr_sites * sizeof(MSATraceSite);
+        if (write(msa_trace.fd, msa_trace.sites, len) != len) {
+            error_report("msa-trace: failed to write site table");
+        }
+        len = msa_trace.nr_opcodes * sizeof(MSATraceOpcode);
+        if (write(msa_trace.fd, msa_trace.opcodes, len) != len) {
+            error_report("msa-trace: failed to write opcode table");
+        }
+        msa_trace_write_header();
+        close(msa_trace.fd);
+        msa_trace.fd = -1;
+    }
+    if (msa_trace.profile_file) {
+        msa_trace_write_profile();
+    }
+    if (msa_trace.metrics) {
+        msa_trace_write_metrics_locked();
+        msa_metrics_free(msa_trace.metrics);
+        msa_trace.metrics = NULL;
+    }
+    if (msa_trace.cache) {
+        msa_trace_write_cache_locked();
+        msa_cache_free(msa_trace.cache);
+        msa_trace.cache = NULL;
+    }
+    msa_trace.enabled = false;
+    qemu_mutex_unlock(&msa_trace.lock);
+}
+
+/*
+ * Return the trace id of @name, registering it on first use.  Names are
+ * interned by value so every call site of the same mnemonic shares one id.
+ */
+int msa_trace_opcode(const char *name, unsigned flags, unsigned size)
+{
+    gpointer id;
+    MSATraceOpcode *op;
+
+    if (!msa_trace.opcode_ids) {
+        msa_trace.opcode_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+    if (g_hash_table_lookup_extended(msa_trace.opcode_ids, name, NULL, &id)) {
+        return GPOINTER_TO_INT(id);
+    }
+    if (msa_trace.nr_opcodes == MSA_TRACE_MAX_OPCODES) {
+        error_report("msa-trace: too many opcodes, '%s' not traced", name);
+        g_hash_table_insert(msa_trace.opcode_ids, (gpointer)name,
+                            GINT_TO_POINTER(-1));
+        return -1;
+    }
+
+    op = &msa_trace.opcodes[msa_trace.nr_opcodes];
+    pstrcpy(op->name, sizeof(op->name), name);
+    op->flags = flags;
+    op->size = size;
+    g_hash_table_insert(msa_trace.opcode_ids, (gpointer)name,
+                        GINT_TO_POINTER(msa_trace.nr_opcodes));
+    return msa_trace.nr_opcodes++;
+}
+
+/*
+ * Return the id of the load/store site of opcode @opc at @pc, registering
+ * it on first use, or -1 once the site table is full.  Retranslating an
+ * instruction reuses its id.  Translation is serialized by tb_lock.
+ */
+int msa_trace_site(int opc, uint64_t pc)
+{
+    uint64_t key = (pc * MSA_TRACE_MAX_OPCODES) + opc;
+    gpointer id;
+    int site;
+
+    if (!msa_trace.site_ids) {
+        msa_trace.site_ids = g_hash_table_new(g_int64_hash, g_int64_equal);
+    }
+    if (g_hash_table_lookup_extended(msa_trace.site_ids, &key, NULL, &id)) {
+        return GPOINTER_TO_INT(id);
+    }
+    if (msa_trace.nr_sites == MSA_TRACE_MAX_SITES) {
+        static bool warned;
+
+        if (!warned) {
+            error_report("msa-trace: more than %d load/store sites, "
+                         "further accesses are not traced",
+                         MSA_TRACE_MAX_SITES);
+            warned = true;
+        }
+        return -1;
+    }
+
+    site = msa_trace.nr_sites++;
+    msa_trace.sites[site].pc = pc;
+    msa_trace.sites[site].opc = opc;
+    msa_trace.site_keys[site] = key;
+    g_hash_table_insert(msa_trace.site_ids, &msa_trace.site_keys[site],
+                        GINT_TO_POINTER(site));
+    return site;
+}
+
+/*
+ * Append the opcode and site tables to @data, for a persistent
+ * translation cache: cached code embeds the ids it was translated with.
+ */
+void msa_trace_save_tables(GByteArray *data)
+{
+    uint32_t n[2] = { msa_trace.nr_opcodes, msa_trace.nr_sites };
+    MSATraceOpcode op;
+    int i;
+
+    g_byte_array_append(data, (guint8 *)n, sizeof(n));
+    for (i = 0; i < msa_trace.nr_opcodes; i++) {
+        op = msa_trace.opcodes[i];
+        op.count = 0;
+        g_byte_array_append(data, (guint8 *)&op, sizeof(op));
+    }
+    g_byte_array_append(data, (guint8 *)msa_trace.sites,
+                        msa_trace.nr_sites * sizeof(MSATraceSite));
+}
+
+/*
+ * Restore the tables saved by msa_trace_save_tables().  Only possible
+ * before anything has been translated, so that the ids still match.
+ */
+bool msa_trace_load_tables(const void *data, size_t size)
+{
+    const MSATraceOpcode *ops;
+    const MSATraceSite *sites;
+    uint32_t n[2];
+    int i;
+
+    if (size < sizeof(n)) {
+        return false;
+    }
+    memcpy(n, data, sizeof(n));
+    if (n[0] > MSA_TRACE_MAX_OPCODES || n[1] > MSA_TRACE_MAX_SITES ||
+        size != sizeof(n) + n[0] * sizeof(MSATraceOpcode) +
+                n[1] * sizeof(MSATraceSite) ||
+        msa_trace.nr_opcodes || msa_trace.nr_sites) {
+        return false;
+    }
+    ops = (const MSATraceOpcode *)((const uint8_t *)data + sizeof(n));
+    sites = (const MSATraceSite *)(ops + n[0]);
+
+    if (!msa_trace.opcode_ids) {
+        msa_trace.opcode_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+    for (i = 0; i < n[0]; i++) {
+        msa_trace.opcodes[i] = ops[i];
+        msa_trace.opcodes[i].name[MSA_TRACE_NAME_LEN - 1] = 0;
+        g_hash_table_insert(msa_trace.opcode_ids, msa_trace.opcodes[i].name,
+                            GINT_TO_POINTER(i));
+    }
+    msa_trace.nr_opcodes = n[0];
+
+    if (!msa_trace.site_ids) {
+        msa_trace.site_ids = g_hash_table_new(g_int64_hash, g_int64_equal);
+    }
+    for (i = 0; i < n[1]; i++) {
+        msa_trace.sites[i] = sites[i];
+        msa_trace.site_keys[i] = sites[i].pc * MSA_TRACE_MAX_OPCODES +
+                                 sites[i].opc;
+        g_hash_table_insert(msa_trace.site_ids, &msa_trace.site_keys[i],
+                            GINT_TO_POINTER(i));
+    }
+    msa_trace.nr_sites = n[1];
+    return true;
+}
+
+/*
+ * Return the profile entry of the block starting at @pc, registering it
+ * on first use, or NULL when blocks are not profiled.  Translation is
+ * serialized by tb_lock.
+ */
+MSATraceBlock *msa_trace_block(uint64_t pc)
+{
+    MSATraceBlock **chunk;
+    MSATraceBlock *b;
+    gpointer id;
+
+    if (!msa_trace.profile_file) {
+        return NULL;
+    }
+    if (!msa_trace.block_ids) {
+        msa_trace.block_ids = g_hash_table_new(g_int64_hash, g_int64_equal);
+    }
+    if (g_hash_table_lookup_extended(msa_trace.block_ids, &pc, NULL, &id)) {
+        return msa_trace_block_at(GPOINTER_TO_INT(id));
+    }
+    if (msa_trace.nr_blocks == MSA_TRACE_MAX_BLOCKS) {
+        static bool warned;
+
+        if (!warned) {
+            error_report("msa-trace: more than %d blocks, "
+                         "further blocks are not profiled",
+                         MSA_TRACE_MAX_BLOCKS);
+            warned = true;
+        }
+        return NULL;
+    }
+
+    /* Blocks never move: generated code holds the address of the count */
+    chunk = &msa_trace.blocks[msa_trace.nr_blocks / MSA_TRACE_BLOCK_CHUNK];
+    if (!*chunk) {
+        *chunk = g_new0(MSATraceBlock, MSA_TRACE_BLOCK_CHUNK);
+    }
+    b = msa_trace_block_at(msa_trace.nr_blocks);
+    b->pc = pc;
+    g_hash_table_insert(msa_trace.block_ids, &b->pc,
+                        GINT_TO_POINTER(msa_trace.nr_blocks));
+    msa_trace.nr_blocks++;
+    return b;
+}
+
+/*
+ * Restrict tracing to [@start, @end).  Either bound may be
+ * MSA_TRACE_ROI_NONE, leaving that side to the guest markers, and @end
+ * may be MSA_TRACE_ROI_RETURN to stop when the code entered at @start
+ * returns to its caller.  Without a region the whole run is traced.
+ */
+void msa_trace_set_roi(uint64_t start, uint64_t end)
+{
+    msa_trace.roi_set = true;
+    msa_trace.roi_start = start;
+    msa_trace.roi_end = end;
+}
+
+bool msa_trace_roi_set(void)
+{
+    return msa_trace.roi_set;
+}
+
+uint64_t msa_trace_roi_start(void)
+{
+    return msa_trace.roi_start;
+}
+
+uint64_t msa_trace_roi_end(void)
+{
+    return msa_trace.roi_end;
+}
+
+/*
+ * Write out the vCPU's records and rewind its cursor, allocating the
+ * buffer on first use.  The generated code calls this at the start of a
+ * TB when fewer than MSA_TRACE_TB_RESERVE bytes are left.
+ */
+void msa_trace_cpu_flush(CPUMIPSState *env)
+{
+    if (unlikely(!env->trace_buf)) {
+        env->trace_buf = g_new(MSATraceBuffer, 1);
+        env->trace_pos = env->trace_buf->records;
+        env->trace_end = env->trace_buf->records + MSA_TRACE_BUF_RECORDS;
+        return;
+    }
+
+    qemu_mutex_lock(&msa_trace.lock);
+    msa_trace_flush_locked(env);
+    qemu_mutex_unlock(&msa_trace.lock);
+}
+
+void helper_msa_trace_flush(CPUMIPSState *env)
+{
+    msa_trace_cpu_flush(env);
+}
+
+/* Count an execution of a block translated for parallel vCPUs */
+void helper_msa_trace_block_count(void *count)
+{
+    atomic_inc((uint64_t *)count);
+}
+
+/*
+ * A vCPU created by cpu_copy() inherits its parent's buffer and
+ * counters; drop them so that the new thread starts with its own.
+ */
+void msa_trace_cpu_reset(CPUMIPSState *env)
+{
+    env->trace_buf = NULL;
+    env->trace_pos = NULL;
+    env->trace_end = NULL;
+    memset(env->trace_counts, 0, sizeof(env->trace_counts));
+}
+
+void msa_trace_cpu_release(CPUMIPSState *env)
+{
+    MSATraceBuffer *buf = env->trace_buf;
+
+    if (!msa_trace.enabled) {
+        return;
+    }
+    qemu_mutex_lock(&msa_trace.lock);
+    if (buf) {
+        msa_trace_flush_locked(env);
+    }
+    msa_trace_add_counts_locked(env);
+    qemu_mutex_unlock(&msa_trace.lock);
+
+    msa_trace_cpu_reset(env);
+    g_free(buf);
+}
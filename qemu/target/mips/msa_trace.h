@@ -0,0 +1,145 @@
+/*
+ * MIPS instruction trace sink for MSA profiling.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef MIPS_MSA_TRACE_H
+#define MIPS_MSA_TRACE_H
+
+/*
+ * Trace file layout (all fields in host byte order):
+ *
+ *   MSATraceHeader                         at offset 0
+ *   uint64_t[header.nr_records]            at offset header.header_size
+ *   MSATraceSite[header.nr_sites]          at offset header.sites_offset
+ *   MSATraceOpcode[header.nr_opcodes]      at offset header.opcodes_offset
+ *
+ * The tables and the record count are only valid once the trace has
+ * been closed; a trace with opcodes_offset == 0 was truncated.
+ *
+ * Every record is one guest memory access, written by the generated code
+ * when the access executes.  It packs the guest virtual address with the
+ * static load/store site that performed it; the site gives the PC and
+ * the opcode, and the opcode gives the access width.
+ *
+ * The dynamic execution count of every opcode is kept separately in
+ * CPUMIPSState.trace_counts, incremented by code generated inline with
+ * the instruction, and summed over all vCPUs into MSATraceOpcode.count
+ * when the trace is closed.
+ */
+#define MSA_TRACE_MAGIC         "MSATRACE"
+#define MSA_TRACE_VERSION       3
+
+#define MSA_TRACE_NAME_LEN      24
+#define MSA_TRACE_MAX_OPCODES   1024
+
+#define MSA_TRACE_ADDR_BITS     48
+#define MSA_TRACE_ADDR_MASK     ((1ULL << MSA_TRACE_ADDR_BITS) - 1)
+#define MSA_TRACE_MAX_SITES     (1 << (64 - MSA_TRACE_ADDR_BITS))
+#define MSA_TRACE_REC_SITE(rec) ((rec) >> MSA_TRACE_ADDR_BITS)
+#define MSA_TRACE_REC_ADDR(rec) ((rec) & MSA_TRACE_ADDR_MASK)
+
+/* Records buffered per vCPU before they are written out in one chunk */
+#define MSA_TRACE_BUF_RECORDS   (128 * 1024)
+/*
+ * Free space guaranteed at the start of every traced TB: enough for one
+ * access per guest instruction.
+ */
+#define MSA_TRACE_TB_RESERVE    (TCG_MAX_INSNS * sizeof(uint64_t))
+
+/* Opcode flags */
+#define MSA_TRACE_F_MSA         0x01 /* MSA ASE instruction */
+#define MSA_TRACE_F_LOAD        0x02 /* reads memory */
+#define MSA_TRACE_F_STORE       0x04 /* writes memory */
+#define MSA_TRACE_F_LDST        (MSA_TRACE_F_LOAD | MSA_TRACE_F_STORE)
+
+/*
+ * Region of interest.  Instrumentation is only generated for TBs
+ * translated with MIPS_HFLAG_TRACE set; the flag is toggled by the
+ * generated code when execution reaches a region boundary, so code
+ * outside the region runs uninstrumented TBs.
+ *
+ * Boundaries are PCs given on the command line, or guest markers:
+ * "ori $zero, $zero, imm" is a no-op on every MIPS implementation.
+ */
+#define MSA_TRACE_ROI_NONE      UINT64_MAX  /* no PC boundary */
+#define MSA_TRACE_ROI_RETURN    (UINT64_MAX - 1) /* end when start returns */
+#define MSA_TRACE_ROI_START_INSN 0x34007001 /* ori $zero, $zero, 0x7001 */
+#define MSA_TRACE_ROI_STOP_INSN  0x34007000 /* ori $zero, $zero, 0x7000 */
+
+/*
+ * Block profile: every traced TB counts its executions, and records the
+ * mix of instruction classes it contains when it is translated.
+ */
+#define MSA_TRACE_BLOCK_CHUNK   4096
+#define MSA_TRACE_MAX_BLOCKS    (256 * MSA_TRACE_BLOCK_CHUNK)
+
+enum {
+    MSA_TRACE_CLASS_ALU,        /* scalar, everything not below */
+    MSA_TRACE_CLASS_LDST,       /* scalar load/store */
+    MSA_TRACE_CLASS_MSA,        /* MSA arithmetic */
+    MSA_TRACE_CLASS_MSA_LDST,   /* MSA load/store */
+    MSA_TRACE_CLASS_BRANCH,     /* branches and jumps */
+    MSA_TRACE_NR_CLASSES
+};
+
+typedef struct MSATraceBlock {
+    uint64_t pc;
+    uint64_t count;             /* executions, bumped by generated code */
+    uint32_t insns;
+    uint32_t cycles;            /* estimated by msa_timing.c */
+    uint32_t mix[MSA_TRACE_NR_CLASSES];
+} MSATraceBlock;
+
+typedef struct MSATraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t opcode_size;
+    uint64_t nr_records;
+    uint64_t opcodes_offset;
+    uint32_t nr_opcodes;
+    uint32_t site_size;
+    uint64_t sites_offset;
+    uint32_t nr_sites;
+    uint32_t reserved;
+} MSATraceHeader;
+
+typedef struct MSATraceOpcode {
+    char name[MSA_TRACE_NAME_LEN];
+    uint8_t flags;
+    uint8_t size;               /* access size in bytes, 0 if none */
+    uint8_t reserved[6];
+    uint64_t count;             /* times executed */
+} MSATraceOpcode;
+
+typedef struct MSATraceSite {
+    uint64_t pc;
+    uint16_t opc;               /* index into the opcode table */
+    uint16_t reserved[3];
+} MSATraceSite;
+
+struct CPUMIPSState;
+typedef struct MSATraceBuffer MSATraceBuffer;
+
+void msa_trace_open(const char *filename, const char *metrics_filename,
+                    const char *profile_filename, const char *cache_arg);
+void msa_trace_close(void);
+bool msa_trace_enabled(void);
+int msa_trace_opcode(const char *name, unsigned flags, unsigned size);
+int msa_trace_site(int opc, uint64_t pc);
+MSATraceBlock *msa_trace_block(uint64_t pc);
+void msa_trace_save_tables(GByteArray *data);
+bool msa_trace_load_tables(const void *data, size_t size);
+void msa_trace_set_roi(uint64_t start, uint64_t end);
+bool msa_trace_roi_set(void);
+uint64_t msa_trace_roi_start(void);
+uint64_t msa_trace_roi_end(void);
+void msa_trace_cpu_flush(struct CPUMIPSState *env);
+void msa_trace_cpu_reset(struct CPUMIPSState *env);
+void msa_trace_cpu_release(struct CPUMIPSState *env);
+
+#endif
@@ -27,6 +27,7 @@
 #include "disas/disas.h"
 #include "exec/exec-all.h"
 #include "tcg-op.h"
+#include "tcg-op-gvec.h"
 #include "exec/cpu_ldst.h"
 #include "hw/mips/cpudevs.h"
 
@@ -37,30 +38,125 @@
 #include "target/mips/trace.h"
 #include "trace-tcg.h"
 #include "exec/log.h"
+#include "msa_trace.h"
+#include "msa_timing.h"
 
 #define MIPS_DEBUG_DISAS 0
 
 #define USUAL_OPCS
 #define MSA_LOG
 
-FILE* log_msa;
+/* PC of the instruction being translated, and whether it lies in the
+   trace region, for the trace sink.  Translation is serialized by
+   tb_lock.  */
+static target_ulong log_pc;
+static bool log_active;
+
+/* Block profile of the TB being translated: its entry, the class and
+   name of the current instruction, the instruction mix so far and the
+   pipeline model of the block.  */
+static MSATraceBlock *log_block;
+static unsigned log_class;
+static const char *log_name;
+static uint32_t log_mix[MSA_TRACE_NR_CLASSES];
+static uint32_t log_insns;
+static MSATiming log_timing;
+
+static int log_trace(const char *instr_name, unsigned flags, unsigned size)
+{
+    int opc;
+    size_t count_ofs;
+    TCGv_i64 t0;
+
+    if (!log_active) {
+        return -1;
+    }
+    if (flags & MSA_TRACE_F_MSA) {
+        log_class = (flags & MSA_TRACE_F_LDST) ? MSA_TRACE_CLASS_MSA_LDST
+                                               : MSA_TRACE_CLASS_MSA;
+    } else if (flags & MSA_TRACE_F_LDST) {
+        log_class = MSA_TRACE_CLASS_LDST;
+    }
+    log_name = instr_name;
+    opc = msa_trace_opcode(instr_name, flags, size);
+    if (opc < 0) {
+        return opc;
+    }
+
+    /* Count executions rather than translations: the counter is bumped
+       by the generated code every time the instruction runs.  */
+    count_ofs = offsetof(CPUMIPSState, trace_counts) + opc * sizeof(uint64_t);
+    t0 = tcg_temp_new_i64();
+    tcg_gen_ld_i64(t0, cpu_env, count_ofs);
+    tcg_gen_addi_i64(t0, t0, 1);
+    tcg_gen_st_i64(t0, cpu_env, count_ofs);
+    tcg_temp_free_i64(t0);
+    return opc;
+}
+
+/* Start profiling the traced code from @pc to the end of the TB.  */
+static void gen_trace_block_start(target_ulong pc)
+{
+    TCGv_ptr t0;
+    TCGv_i64 t1;
+
+    log_block = msa_trace_block(pc);
+    if (!log_block) {
+        return;
+    }
+    memset(log_mix, 0, sizeof(log_mix));
+    log_insns = 0;
+    msa_timing_reset(&log_timing);
+
+    t0 = tcg_const_ptr(&log_block->count);
+    if (tcg_ctx->tb_cflags & CF_PARALLEL) {
+        /* Other guest threads may run the same block concurrently */
+        gen_helper_msa_trace_block_count(t0);
+    } else {
+        t1 = tcg_temp_new_i64();
+        tcg_gen_ld_i64(t1, t0, 0);
+        tcg_gen_addi_i64(t1, t1, 1);
+        tcg_gen_st_i64(t1, t0, 0);
+        tcg_temp_free_i64(t1);
+    }
+    tcg_temp_free_ptr(t0);
+}
+
+/* @insn is the 32-bit opcode, or 0 for compressed ISAs whose operands
+   the timing model does not decode.  */
+static void trace_block_insn(uint32_t insn, bool branch)
+{
+    unsigned cls = branch ? MSA_TRACE_CLASS_BRANCH : log_class;
+
+    if (log_block && log_class < MSA_TRACE_NR_CLASSES) {
+        log_mix[cls]++;
+        log_insns++;
+        msa_timing_insn(&log_timing, insn, log_name, cls);
+    }
+}
+
+/* A retranslated block replaces the mix of the previous translation.  */
+static void trace_block_end(void)
+{
+    if (log_block) {
+        memcpy(log_block->mix, log_mix, sizeof(log_mix));
+        log_block->insns = log_insns;
+        log_block->cycles = log_timing.clock;
+        log_block = NULL;
+    }
+}
+
 void log_instruction(const char* instr_name)
 {
 #ifdef USUAL_OPCS
-    FILE* log_file = fopen("log_msa", "a");
-    if(log_file != 0)
-    	fprintf(log_file, "%s\n", instr_name);
-    fclose(log_file);
+    log_trace(instr_name, 0, 0);
 #endif
 }
 
 void log_msa_instruction(const char* instr_name)
 {
 #ifdef MSA_LOG
-    FILE* log_file = fopen("log_msa", "a");
-    if(log_file != 0)
-    	fprintf(log_file, "%s\n", instr_name);
-    fclose(log_file);
+    log_trace(instr_name, MSA_TRACE_F_MSA, 0);
 #endif
 }
 
@@ -1408,26 +1504,81 @@ static TCGv_i32 fpu_fcr0, fpu_fcr31;
 static TCGv_i64 fpu_f64[32];
 static TCGv_i64 msa_wr_d[64];
 
-void log_ldst_instruction(const char* instr_name, int base, int16_t offset)
+/* MSA register @w as an array of 64-bit lanes, for tcg-op-gvec.h */
+#define MSA_WR(w)       (&msa_wr_d[(w) * 2])
+#define MSA_WR_LANES    (MSA_WRLEN / 64)
+
+static TCGv_ptr cpu_trace_pos;
+
+/* All MIPS store mnemonics start with 'S', all loads with 'L'.  */
+#define LOG_LDST_FLAGS(name) \
+    ((name)[0] == 'S' ? MSA_TRACE_F_STORE : MSA_TRACE_F_LOAD)
+
+/* Make sure the vCPU trace buffer has room for every access of the TB.  */
+static void gen_trace_reserve(void)
+{
+    TCGv_ptr t0 = tcg_temp_new_ptr();
+    TCGv_ptr t1 = tcg_temp_new_ptr();
+    TCGLabel *l1 = gen_new_label();
+
+    tcg_gen_ld_ptr(t0, cpu_env, offsetof(CPUMIPSState, trace_end));
+    tcg_gen_addi_ptr(t1, cpu_trace_pos, MSA_TRACE_TB_RESERVE);
+    tcg_gen_brcond_ptr(TCG_COND_LEU, t1, t0, l1);
+    gen_helper_msa_trace_flush(cpu_env);
+    gen_set_label(l1);
+    tcg_temp_free_ptr(t0);
+    tcg_temp_free_ptr(t1);
+}
+
+/* Record the runtime effective address of a load/store.  The fast path
+   is a single store through the trace cursor, which TCG keeps in a host
+   register like any other global.  */
+static void gen_trace_ldst(int opc, TCGv addr)
+{
+    int site;
+    TCGv_i64 t0;
+
+    if (opc < 0) {
+        return;
+    }
+    site = msa_trace_site(opc, log_pc);
+    if (site < 0) {
+        return;
+    }
+
+    t0 = tcg_temp_new_i64();
+    tcg_gen_extu_tl_i64(t0, addr);
+    tcg_gen_andi_i64(t0, t0, MSA_TRACE_ADDR_MASK);
+    tcg_gen_ori_i64(t0, t0, (uint64_t)site << MSA_TRACE_ADDR_BITS);
+    tcg_gen_st_i64(t0, cpu_trace_pos, 0);
+    tcg_gen_addi_ptr(cpu_trace_pos, cpu_trace_pos, sizeof(uint64_t));
+    tcg_temp_free_i64(t0);
+}
+
+void log_ldst_instruction(const char* instr_name, TCGv addr, unsigned size)
 {
 #ifdef USUAL_OPCS
-    FILE* log_file = fopen("log_msa", "a");
-    if(log_file != 0)
-    	//согласно информации из файла tcg.h TCGv=target_ulong,
-    	//тк мы работаем с mips64, то это будет uint64_t
-    	fprintf(log_file, "%s    0x%lx\n", instr_name, (uint64_t)cpu_gpr[base]+offset);
-    fclose(log_file);
+    gen_trace_ldst(log_trace(instr_name, LOG_LDST_FLAGS(instr_name), size),
+                   addr);
 #endif
 }
 
-void log_msa_ldst_instruction(const char* instr_name, int base, int16_t offset)
+/* PC-relative loads: the address is known at translation time.  */
+void log_pcrel_instruction(const char* instr_name, target_long addr,
+                           unsigned size)
+{
+    TCGv t0 = tcg_const_tl(addr);
+
+    log_ldst_instruction(instr_name, t0, size);
+    tcg_temp_free(t0);
+}
+
+void log_msa_ldst_instruction(const char* instr_name, TCGv addr)
 {
 #ifdef MSA_LOG
-    FILE* log_file = fopen("log_msa", "a");
-    if(log_file != 0) {
-    	fprintf(log_file, "%s    0x%lx\n", instr_name, (uint64_t)cpu_gpr[base]+offset);
-    }
-    fclose(log_file);
+    gen_trace_ldst(log_trace(instr_name, MSA_TRACE_F_MSA |
+                             LOG_LDST_FLAGS(instr_name + 4), 16),
+                   addr);
 #endif
 }
 
@@ -2122,32 +2273,45 @@ OP_LD_ATOMIC(lld,ld64);
 #undef OP_LD_ATOMIC
 
 #ifdef CONFIG_USER_ONLY
-#define OP_ST_ATOMIC(insn,fname,ldname,almask)                               \
+/*
+ * SC succeeds if its address is the one of the last LL and memory still
+ * holds the value LL loaded.  Both are checked and the store is done by
+ * one host compare-and-swap, so guest threads running in parallel need
+ * no exclusive section.  Any SC clears the link.  ARG1 and ARG2 must be
+ * local temps.
+ */
+#define OP_ST_ATOMIC(insn,fname,ldname,almask,memop)                         \
 static inline void op_st_##insn(TCGv arg1, TCGv arg2, int rt, int mem_idx,   \
                                 DisasContext *ctx)                           \
 {                                                                            \
-    TCGv t0 = tcg_temp_new();                                                \
+    TCGv t0 = tcg_temp_local_new();                                          \
+    TCGv t1 = tcg_temp_new();                                                \
     TCGLabel *l1 = gen_new_label();                                          \
     TCGLabel *l2 = gen_new_label();                                          \
+    TCGLabel *l3 = gen_new_label();                                          \
                                                                              \
     tcg_gen_andi_tl(t0, arg2, almask);                                       \
     tcg_gen_brcondi_tl(TCG_COND_EQ, t0, 0, l1);                              \
-    tcg_gen_st_tl(arg2, cpu_env, offsetof(CPUMIPSState, CP0_BadVAddr));          \
+    tcg_gen_st_tl(arg2, cpu_env, offsetof(CPUMIPSState, CP0_BadVAddr));      \
     generate_exception(ctx, EXCP_AdES);                                      \
     gen_set_label(l1);                                                       \
-    tcg_gen_ld_tl(t0, cpu_env, offsetof(CPUMIPSState, lladdr));                  \
-    tcg_gen_brcond_tl(TCG_COND_NE, arg2, t0, l2);                            \
-    tcg_gen_movi_tl(t0, rt | ((almask << 3) & 0x20));                        \
-    tcg_gen_st_tl(t0, cpu_env, offsetof(CPUMIPSState, llreg));                   \
-    tcg_gen_st_tl(arg1, cpu_env, offsetof(CPUMIPSState, llnewval));              \
-    generate_exception_end(ctx, EXCP_SC);                                    \
-    gen_set_label(l2);                                                       \
+    tcg_gen_ld_tl(t0, cpu_env, offsetof(CPUMIPSState, lladdr));              \
+    tcg_gen_brcond_tl(TCG_COND_EQ, arg2, t0, l2);                            \
     tcg_gen_movi_tl(t0, 0);                                                  \
+    tcg_gen_br(l3);                                                          \
+    gen_set_label(l2);                                                       \
+    tcg_gen_ld_tl(t1, cpu_env, offsetof(CPUMIPSState, llval));               \
+    tcg_gen_atomic_cmpxchg_tl(t0, arg2, t1, arg1, mem_idx, memop);           \
+    tcg_gen_setcond_tl(TCG_COND_EQ, t0, t0, t1);                             \
+    gen_set_label(l3);                                                       \
+    tcg_gen_movi_tl(t1, -1);                                                 \
+    tcg_gen_st_tl(t1, cpu_env, offsetof(CPUMIPSState, lladdr));              \
     gen_store_gpr(t0, rt);                                                   \
+    tcg_temp_free(t1);                                                       \
     tcg_temp_free(t0);                                                       \
 }
 #else
-#define OP_ST_ATOMIC(insn,fname,ldname,almask)                               \
+#define OP_ST_ATOMIC(insn,fname,ldname,almask,memop)                         \
 static inline void op_st_##insn(TCGv arg1, TCGv arg2, int rt, int mem_idx,   \
                                 DisasContext *ctx)                           \
 {                                                                            \
@@ -2157,9 +2321,9 @@ static inline void op_st_##insn(TCGv arg1, TCGv arg2, int rt, int mem_idx,   \
     tcg_temp_free(t0);                                                       \
 }
 #endif
-OP_ST_ATOMIC(sc,st32,ld32s,0x3);
+OP_ST_ATOMIC(sc,st32,ld32s,0x3,MO_TESL);
 #if defined(TARGET_MIPS64)
-OP_ST_ATOMIC(scd,st64,ld64,0x7);
+OP_ST_ATOMIC(scd,st64,ld64,0x7,MO_TEQ);
 #endif
 #undef OP_ST_ATOMIC
 
@@ -2210,25 +2374,25 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
     switch (opc) {
 #if defined(TARGET_MIPS64)
     case OPC_LWU:
-        log_ldst_instruction("LWU", base, offset); //Запись инструкции в лог-файл
+        log_ldst_instruction("LWU", t0, 4); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TEUL |
                            ctx->default_tcg_memop_mask);
         gen_store_gpr(t0, rt);
         break;
     case OPC_LD:
-        log_ldst_instruction("LD", base, offset); //Запись инструкции в лог-файл
+        log_ldst_instruction("LD", t0, 8); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TEQ |
                            ctx->default_tcg_memop_mask);
         gen_store_gpr(t0, rt);
         break;
     case OPC_LLD:
     case R6_OPC_LLD:
-    	log_ldst_instruction("LLD", base, offset); //Запись инструкции в лог-файл
+    	log_ldst_instruction("LLD", t0, 8); //Запись инструкции в лог-файл
         op_ld_lld(t0, t0, mem_idx, ctx);
         gen_store_gpr(t0, rt);
         break;
     case OPC_LDL:
-    	log_ldst_instruction("LDL", base, offset); //Запись инструкции в лог-файл
+    	log_ldst_instruction("LDL", t0, 8); //Запись инструкции в лог-файл
         t1 = tcg_temp_new();
         /* Do a byte access to possibly trigger a page
            fault with the unaligned address.  */
@@ -2251,7 +2415,7 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         gen_store_gpr(t0, rt);
         break;
     case OPC_LDR:
-    	log_ldst_instruction("LDR", base, offset); //Запись инструкции в лог-файл
+    	log_ldst_instruction("LDR", t0, 8); //Запись инструкции в лог-файл
         t1 = tcg_temp_new();
         /* Do a byte access to possibly trigger a page
            fault with the unaligned address.  */
@@ -2275,19 +2439,19 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         gen_store_gpr(t0, rt);
         break;
     case OPC_LDPC:
-    	log_ldst_instruction("LDPC", base, offset); //Запись инструкции в лог-файл
         t1 = tcg_const_tl(pc_relative_pc(ctx));
         gen_op_addr_add(ctx, t0, t0, t1);
         tcg_temp_free(t1);
+    	log_ldst_instruction("LDPC", t0, 8); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TEQ);
         gen_store_gpr(t0, rt);
         break;
 #endif
     case OPC_LWPC:
-    	log_ldst_instruction("LWPC", base, offset); //Запись инструкции в лог-файл
         t1 = tcg_const_tl(pc_relative_pc(ctx));
         gen_op_addr_add(ctx, t0, t0, t1);
         tcg_temp_free(t1);
+    	log_ldst_instruction("LWPC", t0, 4); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TESL);
         gen_store_gpr(t0, rt);
         break;
@@ -2296,9 +2460,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LW:
     	if(opc == OPC_LWE)
-    		log_ldst_instruction("LWE", base, offset); //Запись инструкции в лог-файл
+    		log_ldst_instruction("LWE", t0, 4); //Запись инструкции в лог-файл
     	else
-    		log_ldst_instruction("LW", base, offset); //Запись инструкции в лог-файл
+    		log_ldst_instruction("LW", t0, 4); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TESL |
                            ctx->default_tcg_memop_mask);
         gen_store_gpr(t0, rt);
@@ -2308,9 +2472,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LH:
     	if(opc == OPC_LHE)
-    		log_ldst_instruction("LHE", base, offset); //Запись инструкции в лог-файл
+    		log_ldst_instruction("LHE", t0, 2); //Запись инструкции в лог-файл
     	else
-    		log_ldst_instruction("LH", base, offset); //Запись инструкции в лог-файл
+    		log_ldst_instruction("LH", t0, 2); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TESW |
                            ctx->default_tcg_memop_mask);
         gen_store_gpr(t0, rt);
@@ -2320,9 +2484,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LHU:
     	if(opc == OPC_LHUE)
-    		log_ldst_instruction("LHUE", base, offset);
+    		log_ldst_instruction("LHUE", t0, 2);
     	else
-    		log_ldst_instruction("LHU", base, offset); //Запись инструкции в лог-файл
+    		log_ldst_instruction("LHU", t0, 2); //Запись инструкции в лог-файл
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_TEUW |
                            ctx->default_tcg_memop_mask);
         gen_store_gpr(t0, rt);
@@ -2332,9 +2496,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LB:
     	if(opc == OPC_LBE)
-    		log_ldst_instruction("LBE", base, offset);
+    		log_ldst_instruction("LBE", t0, 1);
     	else
-    		log_ldst_instruction("LB", base, offset);
+    		log_ldst_instruction("LB", t0, 1);
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_SB);
         gen_store_gpr(t0, rt);
         break;
@@ -2343,9 +2507,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LBU:
     	if(opc == OPC_LBUE)
-    		log_ldst_instruction("LBUE", base, offset);
+    		log_ldst_instruction("LBUE", t0, 1);
     	else
-    		log_ldst_instruction("LBU", base, offset);
+    		log_ldst_instruction("LBU", t0, 1);
         tcg_gen_qemu_ld_tl(t0, t0, mem_idx, MO_UB);
         gen_store_gpr(t0, rt);
         break;
@@ -2354,9 +2518,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LWL:
     	if(opc == OPC_LWLE)
-    		log_ldst_instruction("LWLE", base, offset);
+    		log_ldst_instruction("LWLE", t0, 4);
     	else
-    		log_ldst_instruction("LWL", base, offset);
+    		log_ldst_instruction("LWL", t0, 4);
         t1 = tcg_temp_new();
         /* Do a byte access to possibly trigger a page
            fault with the unaligned address.  */
@@ -2384,9 +2548,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
         /* fall through */
     case OPC_LWR:
     	if(opc == OPC_LWRE)
-    		log_ldst_instruction("LWRE", base, offset);
+    		log_ldst_instruction("LWRE", t0, 4);
     	else
-    		log_ldst_instruction("LWR", base, offset);
+    		log_ldst_instruction("LWR", t0, 4);
         t1 = tcg_temp_new();
         /* Do a byte access to possibly trigger a page
            fault with the unaligned address.  */
@@ -2416,9 +2580,9 @@ static void gen_ld(DisasContext *ctx, uint32_t opc,
     case OPC_LL:
     case R6_OPC_LL:
     	if(mem_idx == MIPS_HFLAG_UM)
-    		log_ldst_instruction("LLE", base, offset);
+    		log_ldst_instruction("LLE", t0, 4);
     	else
-    		log_ldst_instruction("LL", base, offset);
+    		log_ldst_instruction("LL", t0, 4);
         op_ld_ll(t0, t0, mem_idx, ctx);
         gen_store_gpr(t0, rt);
         break;
@@ -2440,16 +2604,16 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
     switch (opc) {
 #if defined(TARGET_MIPS64)
     case OPC_SD:
-    	log_ldst_instruction("SD", base, offset);
+    	log_ldst_instruction("SD", t0, 8);
         tcg_gen_qemu_st_tl(t1, t0, mem_idx, MO_TEQ |
                            ctx->default_tcg_memop_mask);
         break;
     case OPC_SDL:
-    	log_ldst_instruction("SDL", base, offset);
+    	log_ldst_instruction("SDL", t0, 8);
         gen_helper_0e2i(sdl, t1, t0, mem_idx);
         break;
     case OPC_SDR:
-    	log_ldst_instruction("SDR", base, offset);
+    	log_ldst_instruction("SDR", t0, 8);
         gen_helper_0e2i(sdr, t1, t0, mem_idx);
         break;
 #endif
@@ -2458,9 +2622,9 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
         /* fall through */
     case OPC_SW:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SWE", base, offset);
+        	log_ldst_instruction("SWE", t0, 4);
     	else
-        	log_ldst_instruction("SW", base, offset);
+        	log_ldst_instruction("SW", t0, 4);
         tcg_gen_qemu_st_tl(t1, t0, mem_idx, MO_TEUL |
                            ctx->default_tcg_memop_mask);
         break;
@@ -2469,9 +2633,9 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
         /* fall through */
     case OPC_SH:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SHE", base, offset);
+        	log_ldst_instruction("SHE", t0, 2);
     	else
-        	log_ldst_instruction("SH", base, offset);
+        	log_ldst_instruction("SH", t0, 2);
         tcg_gen_qemu_st_tl(t1, t0, mem_idx, MO_TEUW |
                            ctx->default_tcg_memop_mask);
         break;
@@ -2480,9 +2644,9 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
         /* fall through */
     case OPC_SB:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SBE", base, offset);
+        	log_ldst_instruction("SBE", t0, 1);
     	else
-        	log_ldst_instruction("SB", base, offset);
+        	log_ldst_instruction("SB", t0, 1);
         tcg_gen_qemu_st_tl(t1, t0, mem_idx, MO_8);
         break;
     case OPC_SWLE:
@@ -2490,9 +2654,9 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
         /* fall through */
     case OPC_SWL:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SWLE", base, offset);
+        	log_ldst_instruction("SWLE", t0, 4);
     	else
-        	log_ldst_instruction("SWL", base, offset);
+        	log_ldst_instruction("SWL", t0, 4);
         gen_helper_0e2i(swl, t1, t0, mem_idx);
         break;
     case OPC_SWRE:
@@ -2500,9 +2664,9 @@ static void gen_st (DisasContext *ctx, uint32_t opc, int rt,
         /* fall through */
     case OPC_SWR:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SWRE", base, offset);
+        	log_ldst_instruction("SWRE", t0, 4);
     	else
-        	log_ldst_instruction("SWR", base, offset);
+        	log_ldst_instruction("SWR", t0, 4);
         gen_helper_0e2i(swr, t1, t0, mem_idx);
         break;
     }
@@ -2532,7 +2696,7 @@ static void gen_st_cond (DisasContext *ctx, uint32_t opc, int rt,
 #if defined(TARGET_MIPS64)
     case OPC_SCD:
     case R6_OPC_SCD:
-    	log_ldst_instruction("SCD", base, offset);
+    	log_ldst_instruction("SCD", t0, 8);
         op_st_scd(t1, t0, rt, mem_idx, ctx);
         break;
 #endif
@@ -2542,9 +2706,9 @@ static void gen_st_cond (DisasContext *ctx, uint32_t opc, int rt,
     case OPC_SC:
     case R6_OPC_SC:
     	if(mem_idx == MIPS_HFLAG_UM)
-        	log_ldst_instruction("SCE", base, offset);
+        	log_ldst_instruction("SCE", t0, 4);
     	else
-        	log_ldst_instruction("SC", base, offset);
+        	log_ldst_instruction("SC", t0, 4);
         op_st_sc(t1, t0, rt, mem_idx, ctx);
         break;
     }
@@ -2565,7 +2729,7 @@ static void gen_flt_ldst (DisasContext *ctx, uint32_t opc, int ft,
     switch (opc) {
     case OPC_LWC1:
         {
-        	log_ldst_instruction("LWC1", base, offset);
+        	log_ldst_instruction("LWC1", t0, 4);
             TCGv_i32 fp0 = tcg_temp_new_i32();
             tcg_gen_qemu_ld_i32(fp0, t0, ctx->mem_idx, MO_TESL |
                                 ctx->default_tcg_memop_mask);
@@ -2575,7 +2739,7 @@ static void gen_flt_ldst (DisasContext *ctx, uint32_t opc, int ft,
         break;
     case OPC_SWC1:
         {
-        	log_ldst_instruction("SWC1", base, offset);
+        	log_ldst_instruction("SWC1", t0, 4);
             TCGv_i32 fp0 = tcg_temp_new_i32();
             gen_load_fpr32(ctx, fp0, ft);
             tcg_gen_qemu_st_i32(fp0, t0, ctx->mem_idx, MO_TEUL |
@@ -2585,7 +2749,7 @@ static void gen_flt_ldst (DisasContext *ctx, uint32_t opc, int ft,
         break;
     case OPC_LDC1:
         {
-        	log_ldst_instruction("LDC1", base, offset);
+        	log_ldst_instruction("LDC1", t0, 8);
             TCGv_i64 fp0 = tcg_temp_new_i64();
             tcg_gen_qemu_ld_i64(fp0, t0, ctx->mem_idx, MO_TEQ |
                                 ctx->default_tcg_memop_mask);
@@ -2595,7 +2759,7 @@ static void gen_flt_ldst (DisasContext *ctx, uint32_t opc, int ft,
         break;
     case OPC_SDC1:
         {
-        	log_ldst_instruction("SDC1", base, offset);
+        	log_ldst_instruction("SDC1", t0, 8);
             TCGv_i64 fp0 = tcg_temp_new_i64();
             gen_load_fpr64(ctx, fp0, ft);
             tcg_gen_qemu_st_i64(fp0, t0, ctx->mem_idx, MO_TEQ |
@@ -3353,17 +3517,17 @@ static inline void gen_pcrel(DisasContext *ctx, int opc, target_ulong pc,
         }
         break;
     case R6_OPC_LWPC:
-        log_instruction("LWPC"); //Запись инструкции в лог-файл
         offset = sextract32(ctx->opcode << 2, 0, 21);
         addr = addr_add(ctx, pc, offset);
+        log_pcrel_instruction("LWPC", addr, 4); //Запись инструкции в лог-файл
         gen_r6_ld(addr, rs, ctx->mem_idx, MO_TESL);
         break;
 #if defined(TARGET_MIPS64)
     case OPC_LWUPC:
-        log_instruction("LWUPC"); //Запись инструкции в лог-файл
         check_mips_64(ctx);
         offset = sextract32(ctx->opcode << 2, 0, 21);
         addr = addr_add(ctx, pc, offset);
+        log_pcrel_instruction("LWUPC", addr, 4); //Запись инструкции в лог-файл
         gen_r6_ld(addr, rs, ctx->mem_idx, MO_TEUL);
         break;
 #endif
@@ -3390,10 +3554,10 @@ static inline void gen_pcrel(DisasContext *ctx, int opc, target_ulong pc,
         case R6_OPC_LDPC + (1 << 16):
         case R6_OPC_LDPC + (2 << 16):
         case R6_OPC_LDPC + (3 << 16):
-			log_instruction("LDPC"); //Запись инструкции в лог-файл
             check_mips_64(ctx);
             offset = sextract32(ctx->opcode << 3, 0, 21);
             addr = addr_add(ctx, (pc & ~0x7), offset);
+            log_pcrel_instruction("LDPC", addr, 8); //Запись инструкции в лог-файл
             gen_r6_ld(addr, rs, ctx->mem_idx, MO_TEQ);
             break;
 #endif
@@ -19117,6 +19281,76 @@ static void gen_msa_branch(CPUMIPSState *env, DisasContext *ctx, uint32_t op1)
     ctx->hflags |= MIPS_HFLAG_BDS32;
 }
 
+/* Write the TCG globals of MSA register @w back to env.  */
+static void gen_msa_store_wr(int w)
+{
+    if (w >= 0) {
+        tcg_gen_st_i64(msa_wr_d[w * 2], cpu_env,
+                       offsetof(CPUMIPSState, active_fpu.fpr[w].wr.d[0]));
+        tcg_gen_st_i64(msa_wr_d[w * 2 + 1], cpu_env,
+                       offsetof(CPUMIPSState, active_fpu.fpr[w].wr.d[1]));
+    }
+}
+
+/* Reload the TCG globals of MSA register @w from env.  */
+static void gen_msa_load_wr(int w)
+{
+    tcg_gen_ld_i64(msa_wr_d[w * 2], cpu_env,
+                   offsetof(CPUMIPSState, active_fpu.fpr[w].wr.d[0]));
+    tcg_gen_ld_i64(msa_wr_d[w * 2 + 1], cpu_env,
+                   offsetof(CPUMIPSState, active_fpu.fpr[w].wr.d[1]));
+}
+
+/* Call the instance of a per data format helper (see msa_helper.c)
+   for @df, known at translate time.  The instances are declared
+   TCG_CALL_NO_RWG, so the call does not spill and reload every live
+   global: only the operand registers @wd, @ws and @wt (-1 for none)
+   are written back before the call, and @wd is reloaded after it.
+   All other MSA registers and the GPRs stay in host registers until
+   the end of the TB or a helper that reads the globals.  */
+#define gen_helper_msa_df(op, df, wd, ws, wt, ...)              \
+    do {                                                        \
+        gen_msa_store_wr(wd);                                   \
+        if ((ws) != (wd)) {                                     \
+            gen_msa_store_wr(ws);                               \
+        }                                                       \
+        if ((wt) != (wd) && (wt) != (ws)) {                     \
+            gen_msa_store_wr(wt);                               \
+        }                                                       \
+        switch (df) {                                           \
+        case DF_BYTE:                                           \
+            gen_helper_msa_ ## op ## _b(__VA_ARGS__);           \
+            break;                                              \
+        case DF_HALF:                                           \
+            gen_helper_msa_ ## op ## _h(__VA_ARGS__);           \
+            break;                                              \
+        case DF_WORD:                                           \
+            gen_helper_msa_ ## op ## _w(__VA_ARGS__);           \
+            break;                                              \
+        default:                                                \
+            gen_helper_msa_ ## op ## _d(__VA_ARGS__);           \
+            break;                                              \
+        }                                                       \
+        gen_msa_load_wr(wd);                                    \
+    } while (0)
+
+/* tcg_gen_gvec_bitsel() with the byte @i8 replicated in place of the
+   NULL operand.  */
+static void gen_msa_bitseli(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b,
+                            TCGv_i64 *c, uint8_t i8)
+{
+    TCGv_i64 t = tcg_const_i64(dup_const(MO_8, i8));
+    TCGv_i64 imm[MSA_WR_LANES];
+    int i;
+
+    for (i = 0; i < MSA_WR_LANES; i++) {
+        imm[i] = t;
+    }
+    tcg_gen_gvec_bitsel(d, a ? a : imm, b ? b : imm, c ? c : imm,
+                        MSA_WR_LANES);
+    tcg_temp_free_i64(t);
+}
+
 static void gen_msa_i8(CPUMIPSState *env, DisasContext *ctx)
 {
 #define MASK_MSA_I8(op)    (MASK_MSA_MINOR(op) | (op & (0x03 << 24)))
@@ -19131,31 +19365,35 @@ static void gen_msa_i8(CPUMIPSState *env, DisasContext *ctx)
     switch (MASK_MSA_I8(ctx->opcode)) {
     case OPC_ANDI_B:
 		log_msa_instruction("MSA_ANDI_B");
-        gen_helper_msa_andi_b(cpu_env, twd, tws, ti8);
+        tcg_gen_gvec_andi(MSA_WR(wd), MSA_WR(ws), dup_const(MO_8, i8),
+                          MSA_WR_LANES);
         break;
     case OPC_ORI_B:
 		log_msa_instruction("MSA_ORI_B");
-        gen_helper_msa_ori_b(cpu_env, twd, tws, ti8);
+        tcg_gen_gvec_ori(MSA_WR(wd), MSA_WR(ws), dup_const(MO_8, i8),
+                         MSA_WR_LANES);
         break;
     case OPC_NORI_B:
 		log_msa_instruction("MSA_NORI_B");
-		gen_helper_msa_nori_b(cpu_env, twd, tws, ti8);
+        tcg_gen_gvec_nori(MSA_WR(wd), MSA_WR(ws), dup_const(MO_8, i8),
+                          MSA_WR_LANES);
         break;
     case OPC_XORI_B:
 		log_msa_instruction("MSA_XORI_B");
-        gen_helper_msa_xori_b(cpu_env, twd, tws, ti8);
+        tcg_gen_gvec_xori(MSA_WR(wd), MSA_WR(ws), dup_const(MO_8, i8),
+                          MSA_WR_LANES);
         break;
     case OPC_BMNZI_B:
 		log_msa_instruction("MSA_BMNZI_B");
-        gen_helper_msa_bmnzi_b(cpu_env, twd, tws, ti8);
+        gen_msa_bitseli(MSA_WR(wd), NULL, MSA_WR(ws), MSA_WR(wd), i8);
         break;
     case OPC_BMZI_B:
 		log_msa_instruction("MSA_BMZI_B");
-        gen_helper_msa_bmzi_b(cpu_env, twd, tws, ti8);
+        gen_msa_bitseli(MSA_WR(wd), NULL, MSA_WR(wd), MSA_WR(ws), i8);
         break;
     case OPC_BSELI_B:
 		log_msa_instruction("MSA_BSELI_B");
-        gen_helper_msa_bseli_b(cpu_env, twd, tws, ti8);
+        gen_msa_bitseli(MSA_WR(wd), MSA_WR(wd), NULL, MSA_WR(ws), i8);
         break;
     case OPC_SHF_B:
     case OPC_SHF_H:
@@ -19192,7 +19430,6 @@ static void gen_msa_i5(CPUMIPSState *env, DisasContext *ctx)
     uint8_t ws = (ctx->opcode >> 11) & 0x1f;
     uint8_t wd = (ctx->opcode >> 6) & 0x1f;
 
-    TCGv_i32 tdf = tcg_const_i32(df);
     TCGv_i32 twd = tcg_const_i32(wd);
     TCGv_i32 tws = tcg_const_i32(ws);
     TCGv_i32 timm = tcg_temp_new_i32();
@@ -19201,59 +19438,56 @@ static void gen_msa_i5(CPUMIPSState *env, DisasContext *ctx)
     switch (MASK_MSA_I5(ctx->opcode)) {
     case OPC_ADDVI_df:
 		log_msa_instruction("MSA_ADDVI_df");
-        gen_helper_msa_addvi_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_addi(df, MSA_WR(wd), MSA_WR(ws), u5, MSA_WR_LANES);
         break;
     case OPC_SUBVI_df:
 		log_msa_instruction("MSA_SUBVI_df");
-        gen_helper_msa_subvi_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_subi(df, MSA_WR(wd), MSA_WR(ws), u5, MSA_WR_LANES);
         break;
     case OPC_MAXI_S_df:
-        tcg_gen_movi_i32(timm, s5);
 		log_msa_instruction("MSA_MAXI_S_df");
-        gen_helper_msa_maxi_s_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_smaxi(df, MSA_WR(wd), MSA_WR(ws), s5, MSA_WR_LANES);
         break;
     case OPC_MAXI_U_df:
 		log_msa_instruction("MSA_MAXI_U_df");
-        gen_helper_msa_maxi_u_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_umaxi(df, MSA_WR(wd), MSA_WR(ws), u5, MSA_WR_LANES);
         break;
     case OPC_MINI_S_df:
-        tcg_gen_movi_i32(timm, s5);
 		log_msa_instruction("MSA_MINI_S_df");
-        gen_helper_msa_mini_s_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_smini(df, MSA_WR(wd), MSA_WR(ws), s5, MSA_WR_LANES);
         break;
     case OPC_MINI_U_df:
 		log_msa_instruction("MSA_MINI_U_df");
-        gen_helper_msa_mini_u_df(cpu_env, tdf, twd, tws, timm);
+        tcg_gen_gvec_umini(df, MSA_WR(wd), MSA_WR(ws), u5, MSA_WR_LANES);
         break;
     case OPC_CEQI_df:
         tcg_gen_movi_i32(timm, s5);
 		log_msa_instruction("MSA_CEQI_df");
-        gen_helper_msa_ceqi_df(cpu_env, tdf, twd, tws, timm);
+        gen_helper_msa_df(ceqi, df, wd, ws, -1, cpu_env, twd, tws, timm);
         break;
     case OPC_CLTI_S_df:
         tcg_gen_movi_i32(timm, s5);
 		log_msa_instruction("MSA_CLTI_S_df");
-        gen_helper_msa_clti_s_df(cpu_env, tdf, twd, tws, timm);
+        gen_helper_msa_df(clti_s, df, wd, ws, -1, cpu_env, twd, tws, timm);
         break;
     case OPC_CLTI_U_df:
 		log_msa_instruction("MSA_CLTI_U_df");
-        gen_helper_msa_clti_u_df(cpu_env, tdf, twd, tws, timm);
+        gen_helper_msa_df(clti_u, df, wd, ws, -1, cpu_env, twd, tws, timm);
         break;
     case OPC_CLEI_S_df:
         tcg_gen_movi_i32(timm, s5);
 		log_msa_instruction("MSA_CLEI_S_df");
-        gen_helper_msa_clei_s_df(cpu_env, tdf, twd, tws, timm);
+        gen_helper_msa_df(clei_s, df, wd, ws, -1, cpu_env, twd, tws, timm);
         break;
     case OPC_CLEI_U_df:
 		log_msa_instruction("MSA_CLEI_U_df");
-        gen_helper_msa_clei_u_df(cpu_env, tdf, twd, tws, timm);
+        gen_helper_msa_df(clei_u, df, wd, ws, -1, cpu_env, twd, tws, timm);
         break;
     case OPC_LDI_df:
         {
             int32_t s10 = sextract32(ctx->opcode, 11, 10);
-            tcg_gen_movi_i32(timm, s10);
     		log_msa_instruction("MSA_LDI_df");
-            gen_helper_msa_ldi_df(cpu_env, tdf, twd, timm);
+            tcg_gen_gvec_dupi(df, MSA_WR(wd), MSA_WR_LANES, (int64_t)s10);
         }
         break;
     default:
@@ -19262,7 +19496,6 @@ static void gen_msa_i5(CPUMIPSState *env, DisasContext *ctx)
         break;
     }
 
-    tcg_temp_free_i32(tdf);
     tcg_temp_free_i32(twd);
     tcg_temp_free_i32(tws);
     tcg_temp_free_i32(timm);
@@ -19306,27 +19539,27 @@ static void gen_msa_bit(CPUMIPSState *env, DisasContext *ctx)
     switch (MASK_MSA_BIT(ctx->opcode)) {
     case OPC_SLLI_df:
 		log_msa_instruction("MSA_SLLI_df");
-        gen_helper_msa_slli_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(slli, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_SRAI_df:
 		log_msa_instruction("MSA_SRAI_df");
-        gen_helper_msa_srai_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(srai, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_SRLI_df:
 		log_msa_instruction("MSA_SRLI_df");
-        gen_helper_msa_srli_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(srli, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_BCLRI_df:
 		log_msa_instruction("MSA_BCLRI_df");
-		gen_helper_msa_bclri_df(cpu_env, tdf, twd, tws, tm);
+		gen_helper_msa_df(bclri, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_BSETI_df:
 		log_msa_instruction("MSA_BSETI_df");
-        gen_helper_msa_bseti_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(bseti, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_BNEGI_df:
 		log_msa_instruction("MSA_BNEGI_df");
-        gen_helper_msa_bnegi_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(bnegi, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_BINSLI_df:
 		log_msa_instruction("MSA_BINSLI_df");
@@ -19338,19 +19571,19 @@ static void gen_msa_bit(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_SAT_S_df:
 		log_msa_instruction("MSA_SAT_df");
-        gen_helper_msa_sat_s_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(sat_s, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_SAT_U_df:
 		log_msa_instruction("MSA_SAT_U_df");
-        gen_helper_msa_sat_u_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(sat_u, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_SRARI_df:
 		log_msa_instruction("MSA_SRARI_df");
-        gen_helper_msa_srari_df(cpu_env, tdf, twd, tws, tm);
+        gen_helper_msa_df(srari, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     case OPC_SRLRI_df:
 		log_msa_instruction("MSA_SRLRI_df");
-    	gen_helper_msa_srlri_df(cpu_env, tdf, twd, tws, tm);
+    	gen_helper_msa_df(srlri, df, wd, ws, -1, cpu_env, twd, tws, tm);
         break;
     default:
         MIPS_INVAL("MSA instruction");
@@ -19380,27 +19613,34 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
     switch (MASK_MSA_3R(ctx->opcode)) {
     case OPC_SLL_df:
 		log_msa_instruction("MSA_SLL_df");
-        gen_helper_msa_sll_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(sll, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ADDV_df:
 		log_msa_instruction("MSA_ADDV_df");
-        gen_helper_msa_addv_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_add(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                         MSA_WR_LANES);
         break;
     case OPC_CEQ_df:
 		log_msa_instruction("MSA_CEQ_df");
-        gen_helper_msa_ceq_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(ceq, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ADD_A_df:
 		log_msa_instruction("MSA_ADD_A_df");
-        gen_helper_msa_add_a_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(add_a, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_SUBS_S_df:
 		log_msa_instruction("MSA_SUBS_S_df");
-        gen_helper_msa_subs_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(subs_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MULV_df:
 		log_msa_instruction("MSA_MULV_df");
-        gen_helper_msa_mulv_df(cpu_env, tdf, twd, tws, twt);
+        if (df == DF_BYTE) {
+            /* 16 multiplies inline cost more than the helper call */
+            gen_helper_msa_df(mulv, df, wd, ws, wt, cpu_env, twd, tws, twt);
+        } else {
+            tcg_gen_gvec_mul(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                             MSA_WR_LANES);
+        }
         break;
     case OPC_SLD_df:
 		log_msa_instruction("MSA_SLD_df");
@@ -19412,23 +19652,26 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_SRA_df:
 		log_msa_instruction("MSA_SRA_df");
-        gen_helper_msa_sra_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(sra, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_SUBV_df:
 		log_msa_instruction("MSA_SUBV_df");
-        gen_helper_msa_subv_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_sub(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                         MSA_WR_LANES);
         break;
     case OPC_ADDS_A_df:
 		log_msa_instruction("MSA_ADDS_A_df");
-		gen_helper_msa_adds_a_df(cpu_env, tdf, twd, tws, twt);
+		gen_helper_msa_df(adds_a, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
         break;
     case OPC_SUBS_U_df:
 		log_msa_instruction("MSA_SUBS_U_df");
-        gen_helper_msa_subs_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(subs_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MADDV_df:
 		log_msa_instruction("MSA_MADDV_df");
-		gen_helper_msa_maddv_df(cpu_env, tdf, twd, tws, twt);
+		gen_helper_msa_df(maddv, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
         break;
     case OPC_SPLAT_df:
 		log_msa_instruction("MSA_SPLAT_df");
@@ -19436,31 +19679,32 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_SRAR_df:
 		log_msa_instruction("MSA_SRAR_df");
-        gen_helper_msa_srar_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(srar, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_SRL_df:
 		log_msa_instruction("MSA_SRL_df");
-        gen_helper_msa_srl_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(srl, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MAX_S_df:
 		log_msa_instruction("MSA_MAX_S_df");
-        gen_helper_msa_max_s_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_smax(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_CLT_S_df:
 		log_msa_instruction("MSA_CLT_S_df");
-        gen_helper_msa_clt_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(clt_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ADDS_S_df:
 		log_msa_instruction("MSA_ADDS_S_df");
-        gen_helper_msa_adds_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(adds_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_SUBSUS_U_df:
 		log_msa_instruction("MSA_SUBSUS_U_df");
-        gen_helper_msa_subsus_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(subsus_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MSUBV_df:
 		log_msa_instruction("MSA_MSUBV_df");
-        gen_helper_msa_msubv_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(msubv, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_PCKEV_df:
 		log_msa_instruction("MSA_PCKEV_df");
@@ -19468,27 +19712,28 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_SRLR_df:
 		log_msa_instruction("MSA_SRLR_df");
-        gen_helper_msa_srlr_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(srlr, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_BCLR_df:
 		log_msa_instruction("MSA_BCLR_df");
-        gen_helper_msa_bclr_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(bclr, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MAX_U_df:
 		log_msa_instruction("MSA_MAX_U_df");
-        gen_helper_msa_max_u_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_umax(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_CLT_U_df:
 		log_msa_instruction("MSA_CLT_U_df");
-        gen_helper_msa_clt_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(clt_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ADDS_U_df:
 		log_msa_instruction("MSA_ADDS_U_df");
-        gen_helper_msa_adds_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(adds_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_SUBSUU_S_df:
 		log_msa_instruction("MSA_SUBSUU_S_df");
-        gen_helper_msa_subsuu_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(subsuu_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_PCKOD_df:
 		log_msa_instruction("MSA_PCKOD_df");
@@ -19496,27 +19741,30 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_BSET_df:
 		log_msa_instruction("MSA_BSET_df");
-        gen_helper_msa_bset_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(bset, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MIN_S_df:
 		log_msa_instruction("MSA_MIN_S_df");
-        gen_helper_msa_min_s_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_smin(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_CLE_S_df:
 		log_msa_instruction("MSA_CLE_S_df");
-        gen_helper_msa_cle_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(cle_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_AVE_S_df:
 		log_msa_instruction("MSA_AVE_S_df");
-        gen_helper_msa_ave_s_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_savg(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_ASUB_S_df:
 		log_msa_instruction("MSA_ASUB_S_df");
-        gen_helper_msa_asub_s_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_sabsdiff(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                              MSA_WR_LANES);
         break;
     case OPC_DIV_S_df:
 		log_msa_instruction("MSA_DIV_S_df");
-        gen_helper_msa_div_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(div_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ILVL_df:
 		log_msa_instruction("MSA_ILVL_df");
@@ -19524,27 +19772,31 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_BNEG_df:
 		log_msa_instruction("MSA_BNEG_df");
-        gen_helper_msa_bneg_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(bneg, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MIN_U_df:
 		log_msa_instruction("MSA_MIN_U_df");
-        gen_helper_msa_min_u_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_umin(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_CLE_U_df:
 		log_msa_instruction("MSA_CLE_U_df");
-        gen_helper_msa_cle_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(cle_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_AVE_U_df:
 		log_msa_instruction("MSA_AVE_U_df");
-        gen_helper_msa_ave_u_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_uavg(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                          MSA_WR_LANES);
         break;
     case OPC_ASUB_U_df:
 		log_msa_instruction("MSA_ASUB_U_df");
-		gen_helper_msa_asub_u_df(cpu_env, tdf, twd, tws, twt);
+        tcg_gen_gvec_uabsdiff(df, MSA_WR(wd), MSA_WR(ws), MSA_WR(wt),
+                              MSA_WR_LANES);
         break;
     case OPC_DIV_U_df:
 		log_msa_instruction("MSA_DIV_U_df");
-		gen_helper_msa_div_u_df(cpu_env, tdf, twd, tws, twt);
+		gen_helper_msa_df(div_u, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
         break;
     case OPC_ILVR_df:
 		log_msa_instruction("MSA_ILVR_df");
@@ -19552,19 +19804,19 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_BINSL_df:
 		log_msa_instruction("MSA_BINSL_df");
-        gen_helper_msa_binsl_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(binsl, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MAX_A_df:
 		log_msa_instruction("MSA_MAX_A_df");
-        gen_helper_msa_max_a_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(max_a, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_AVER_S_df:
 		log_msa_instruction("MSA_AVER_S_df");
-        gen_helper_msa_aver_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(aver_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MOD_S_df:
 		log_msa_instruction("MSA_MOD_S_df");
-        gen_helper_msa_mod_s_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(mod_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ILVEV_df:
 		log_msa_instruction("MSA_ILVEV_df");
@@ -19572,19 +19824,20 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_BINSR_df:
 		log_msa_instruction("MSA_BINSR_df");
-		gen_helper_msa_binsr_df(cpu_env, tdf, twd, tws, twt);
+		gen_helper_msa_df(binsr, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
         break;
     case OPC_MIN_A_df:
 		log_msa_instruction("MSA_MIN_A_df");
-        gen_helper_msa_min_a_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(min_a, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_AVER_U_df:
 		log_msa_instruction("MSA_AVER_U_df");
-        gen_helper_msa_aver_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(aver_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_MOD_U_df:
 		log_msa_instruction("MSA_MOD_U_df");
-        gen_helper_msa_mod_u_df(cpu_env, tdf, twd, tws, twt);
+        gen_helper_msa_df(mod_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
         break;
     case OPC_ILVOD_df:
 		log_msa_instruction("MSA_ILVOD_df");
@@ -19608,43 +19861,46 @@ static void gen_msa_3r(CPUMIPSState *env, DisasContext *ctx)
         switch (MASK_MSA_3R(ctx->opcode)) {
         case OPC_DOTP_S_df:
     		log_msa_instruction("MSA_DOTP_S_df");
-            gen_helper_msa_dotp_s_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(dotp_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_DOTP_U_df:
     		log_msa_instruction("MSA_DOTP_U_df");
-            gen_helper_msa_dotp_u_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(dotp_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_DPADD_S_df:
     		log_msa_instruction("MSA_DPADD_S_df");
-            gen_helper_msa_dpadd_s_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(dpadd_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_DPADD_U_df:
     		log_msa_instruction("MSA_DPADD_U_df");
-            gen_helper_msa_dpadd_u_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(dpadd_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_DPSUB_S_df:
     		log_msa_instruction("MSA_DPSUB_S_df");
-            gen_helper_msa_dpsub_s_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(dpsub_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_HADD_S_df:
     		log_msa_instruction("MSA_HADD_S_df");
-            gen_helper_msa_hadd_s_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(hadd_s, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_DPSUB_U_df:
     		log_msa_instruction("MSA_DPSUB_U_df");
-    		gen_helper_msa_dpsub_u_df(cpu_env, tdf, twd, tws, twt);
+    		gen_helper_msa_df(dpsub_u, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
             break;
         case OPC_HADD_U_df:
     		log_msa_instruction("MSA_HADD_U_df");
-            gen_helper_msa_hadd_u_df(cpu_env, tdf, twd, tws, twt);
+            gen_helper_msa_df(hadd_u, df, wd, ws, wt, cpu_env, twd, tws, twt);
             break;
         case OPC_HSUB_S_df:
     		log_msa_instruction("MSA_HSUB_S_df");
-    		gen_helper_msa_hsub_s_df(cpu_env, tdf, twd, tws, twt);
+    		gen_helper_msa_df(hsub_s, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
             break;
         case OPC_HSUB_U_df:
     		log_msa_instruction("MSA_HSUB_U_df");
-    		gen_helper_msa_hsub_u_df(cpu_env, tdf, twd, tws, twt);
+    		gen_helper_msa_df(hsub_u, df, wd, ws, wt, cpu_env, twd, tws,
+                                  twt);
             break;
         }
         break;
@@ -19681,7 +19937,7 @@ static void gen_msa_elm_3e(CPUMIPSState *env, DisasContext *ctx)
         break;
     case OPC_MOVE_V:
 		log_msa_instruction("MSA_MOVE_V");
-		gen_helper_msa_move_v(cpu_env, tdt, tsr);
+        tcg_gen_gvec_mov(MSA_WR(dest), MSA_WR(source), MSA_WR_LANES);
         break;
     default:
         MIPS_INVAL("MSA instruction");
@@ -20135,31 +20391,34 @@ static void gen_msa_vec_v(CPUMIPSState *env, DisasContext *ctx)
     switch (MASK_MSA_VEC(ctx->opcode)) {
     case OPC_AND_V:
 		log_msa_instruction("MSA_AND_V");
-        gen_helper_msa_and_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_and(MSA_WR(wd), MSA_WR(ws), MSA_WR(wt), MSA_WR_LANES);
         break;
     case OPC_OR_V:
 		log_msa_instruction("MSA_OR_V");
-        gen_helper_msa_or_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_or(MSA_WR(wd), MSA_WR(ws), MSA_WR(wt), MSA_WR_LANES);
         break;
     case OPC_NOR_V:
 		log_msa_instruction("MSA_NOR_V");
-        gen_helper_msa_nor_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_nor(MSA_WR(wd), MSA_WR(ws), MSA_WR(wt), MSA_WR_LANES);
         break;
     case OPC_XOR_V:
 		log_msa_instruction("MSA_XOR_V");
-        gen_helper_msa_xor_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_xor(MSA_WR(wd), MSA_WR(ws), MSA_WR(wt), MSA_WR_LANES);
         break;
     case OPC_BMNZ_V:
 		log_msa_instruction("MSA_BMNZ_V");
-        gen_helper_msa_bmnz_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_bitsel(MSA_WR(wd), MSA_WR(wt), MSA_WR(ws), MSA_WR(wd),
+                            MSA_WR_LANES);
         break;
     case OPC_BMZ_V:
 		log_msa_instruction("MSA_BMZ_V");
-        gen_helper_msa_bmz_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_bitsel(MSA_WR(wd), MSA_WR(wt), MSA_WR(wd), MSA_WR(ws),
+                            MSA_WR_LANES);
         break;
     case OPC_BSEL_V:
 		log_msa_instruction("MSA_BSEL_V");
-        gen_helper_msa_bsel_v(cpu_env, twd, tws, twt);
+        tcg_gen_gvec_bitsel(MSA_WR(wd), MSA_WR(wd), MSA_WR(wt), MSA_WR(ws),
+                            MSA_WR_LANES);
         break;
     default:
         MIPS_INVAL("MSA instruction");
@@ -20197,6 +20456,92 @@ static void gen_msa_vec(CPUMIPSState *env, DisasContext *ctx)
     }
 }
 
+/* Put the elements of a 64-bit half of a vector register in the order
+   they have in guest memory, or back.  Only needed when the guest and
+   the host differ in endianness: wr_t elements are in host order.  */
+static void gen_msa_swap_elements(TCGv_i64 t, int df)
+{
+#if defined(TARGET_WORDS_BIGENDIAN) != defined(HOST_WORDS_BIGENDIAN)
+    TCGv_i64 t0;
+
+    switch (df) {
+    case DF_BYTE:
+        tcg_gen_bswap64_i64(t, t);
+        break;
+    case DF_HALF:
+        t0 = tcg_temp_new_i64();
+        tcg_gen_rotli_i64(t, t, 32);
+        tcg_gen_shri_i64(t0, t, 16);
+        tcg_gen_andi_i64(t0, t0, 0x0000ffff0000ffffULL);
+        tcg_gen_andi_i64(t, t, 0x0000ffff0000ffffULL);
+        tcg_gen_shli_i64(t, t, 16);
+        tcg_gen_or_i64(t, t, t0);
+        tcg_temp_free_i64(t0);
+        break;
+    case DF_WORD:
+        tcg_gen_rotli_i64(t, t, 32);
+        break;
+    }
+#endif
+}
+
+/* LD.df/ST.df of a vector that stays within one page: two inline 64-bit
+   guest accesses, each with the usual TLB fast path.  Page-crossing
+   vectors go through the element-by-element helpers, which probe both
+   pages before storing anything.  @taddr must be a local temp.  */
+static void gen_msa_ldst(DisasContext *ctx, uint32_t opc, int df, int wd,
+                         TCGv taddr)
+{
+    static void (* const gen_helper[8])(TCGv_ptr, TCGv_i32, TCGv) = {
+        [OPC_LD_B - OPC_LD_B] = gen_helper_msa_ld_b,
+        [OPC_LD_H - OPC_LD_B] = gen_helper_msa_ld_h,
+        [OPC_LD_W - OPC_LD_B] = gen_helper_msa_ld_w,
+        [OPC_LD_D - OPC_LD_B] = gen_helper_msa_ld_d,
+        [OPC_ST_B - OPC_LD_B] = gen_helper_msa_st_b,
+        [OPC_ST_H - OPC_LD_B] = gen_helper_msa_st_h,
+        [OPC_ST_W - OPC_LD_B] = gen_helper_msa_st_w,
+        [OPC_ST_D - OPC_LD_B] = gen_helper_msa_st_d,
+    };
+    TCGMemOp mop = MO_TEQ | MO_UNALN;
+    TCGLabel *l_slow = gen_new_label();
+    TCGLabel *l_done = gen_new_label();
+    TCGv t0 = tcg_temp_new();
+    TCGv_i64 lo = tcg_temp_new_i64();
+    TCGv_i64 hi = tcg_temp_new_i64();
+    TCGv_i32 twd;
+
+    tcg_gen_andi_tl(t0, taddr, ~TARGET_PAGE_MASK);
+    tcg_gen_brcondi_tl(TCG_COND_GTU, t0, TARGET_PAGE_SIZE - MSA_WRLEN / 8,
+                       l_slow);
+    tcg_gen_addi_tl(t0, taddr, 8);
+    if (opc < OPC_ST_B) {
+        tcg_gen_qemu_ld_i64(lo, taddr, ctx->mem_idx, mop);
+        tcg_gen_qemu_ld_i64(hi, t0, ctx->mem_idx, mop);
+        gen_msa_swap_elements(lo, df);
+        gen_msa_swap_elements(hi, df);
+        tcg_gen_mov_i64(msa_wr_d[wd * 2], lo);
+        tcg_gen_mov_i64(msa_wr_d[wd * 2 + 1], hi);
+    } else {
+        tcg_gen_mov_i64(lo, msa_wr_d[wd * 2]);
+        tcg_gen_mov_i64(hi, msa_wr_d[wd * 2 + 1]);
+        gen_msa_swap_elements(lo, df);
+        gen_msa_swap_elements(hi, df);
+        tcg_gen_qemu_st_i64(lo, taddr, ctx->mem_idx, mop);
+        tcg_gen_qemu_st_i64(hi, t0, ctx->mem_idx, mop);
+    }
+    tcg_gen_br(l_done);
+
+    gen_set_label(l_slow);
+    twd = tcg_const_i32(wd);
+    gen_helper[opc - OPC_LD_B](cpu_env, twd, taddr);
+    tcg_temp_free_i32(twd);
+    gen_set_label(l_done);
+
+    tcg_temp_free(t0);
+    tcg_temp_free_i64(lo);
+    tcg_temp_free_i64(hi);
+}
+
 static void gen_msa(CPUMIPSState *env, DisasContext *ctx)
 {
     uint32_t opcode = ctx->opcode;
@@ -20253,46 +20598,37 @@ static void gen_msa(CPUMIPSState *env, DisasContext *ctx)
             uint8_t wd = (ctx->opcode >> 6) & 0x1f;
             uint8_t df = (ctx->opcode >> 0) & 0x3;
 
-            TCGv_i32 twd = tcg_const_i32(wd);
-            TCGv taddr = tcg_temp_new();
+            TCGv taddr = tcg_temp_local_new();
             gen_base_offset_addr(ctx, taddr, rs, s10 << df);
 
             switch (MASK_MSA_MINOR(opcode)) {
             case OPC_LD_B:
-        		log_msa_ldst_instruction("MSA_LD_B", rs, s10 << df);
-                gen_helper_msa_ld_b(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_LD_B", taddr);
                 break;
             case OPC_LD_H:
-        		log_msa_ldst_instruction("MSA_LD_H", rs, s10 << df);
-                gen_helper_msa_ld_h(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_LD_H", taddr);
                 break;
             case OPC_LD_W:
-        		log_msa_ldst_instruction("MSA_LD_W", rs, s10 << df);
-                gen_helper_msa_ld_w(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_LD_W", taddr);
                 break;
             case OPC_LD_D:
-        		log_msa_ldst_instruction("MSA_LD_D", rs, s10 << df);
-                gen_helper_msa_ld_d(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_LD_D", taddr);
                 break;
             case OPC_ST_B:
-        		log_msa_ldst_instruction("MSA_ST_B", rs, s10 << df);
-                gen_helper_msa_st_b(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_ST_B", taddr);
                 break;
             case OPC_ST_H:
-        		log_msa_ldst_instruction("MSA_ST_H", rs, s10 << df);
-        		gen_helper_msa_st_h(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_ST_H", taddr);
                 break;
             case OPC_ST_W:
-        		log_msa_ldst_instruction("MSA_ST_W", rs, s10 << df);
-                gen_helper_msa_st_w(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_ST_W", taddr);
                 break;
             case OPC_ST_D:
-        		log_msa_ldst_instruction("MSA_ST_D", rs, s10 << df);
-                gen_helper_msa_st_d(cpu_env, twd, taddr);
+        		log_msa_ldst_instruction("MSA_ST_D", taddr);
                 break;
             }
+            gen_msa_ldst(ctx, MASK_MSA_MINOR(opcode), df, wd, taddr);
 
-            tcg_temp_free_i32(twd);
             tcg_temp_free(taddr);
         }
         break;
@@ -20993,6 +21329,78 @@ static void decode_opc(CPUMIPSState *env, DisasContext *ctx)
     }
 }
 
+/* Leave a region that ends when its start function returns.  The
+   return address differs from call to call, so rather than compiling
+   it into the TB, compare it with env->trace_roi_ret when the TB is
+   entered (a return always lands on a TB boundary) and, on a match,
+   drop the trace flag and look the TB up again uninstrumented.  */
+static void gen_trace_roi_return(DisasContext *ctx)
+{
+    TCGLabel *l1 = gen_new_label();
+    TCGv t0 = tcg_temp_new();
+
+    tcg_gen_ld_tl(t0, cpu_env, offsetof(CPUMIPSState, trace_roi_ret));
+    tcg_gen_brcondi_tl(TCG_COND_NE, t0, ctx->pc, l1);
+    tcg_temp_free(t0);
+    tcg_gen_andi_i32(hflags, hflags, ~MIPS_HFLAG_TRACE);
+    gen_save_pc(ctx->pc);
+    tcg_gen_exit_tb(0);
+    gen_set_label(l1);
+}
+
+/* Enter or leave the trace region before the instruction at ctx->pc.
+   The new state is stored to env->hflags, so the TBs that follow are
+   looked up (and translated) with or without instrumentation, and the
+   rest of this TB is translated accordingly.  Returns true if the
+   instruction is a region marker, which is not traced itself.  */
+static bool gen_trace_roi(CPUMIPSState *env, DisasContext *ctx)
+{
+    bool active = ctx->hflags & MIPS_HFLAG_TRACE;
+    uint32_t insn = 0;
+    bool marker;
+    uint64_t end;
+
+    if (ctx->hflags & MIPS_HFLAG_BMASK) {
+        return false;
+    }
+    if (!(ctx->hflags & MIPS_HFLAG_M16)) {
+        insn = cpu_ldl_code(env, ctx->pc);
+    }
+
+    if (!active) {
+        marker = insn == MSA_TRACE_ROI_START_INSN;
+        if (!marker && ctx->pc != msa_trace_roi_start()) {
+            return false;
+        }
+        if (msa_trace_roi_end() == MSA_TRACE_ROI_RETURN) {
+            tcg_gen_st_tl(cpu_gpr[31], cpu_env,
+                          offsetof(CPUMIPSState, trace_roi_ret));
+        }
+    } else {
+        marker = insn == MSA_TRACE_ROI_STOP_INSN;
+        end = msa_trace_roi_end();
+        /* A return-address end is checked at run time, see
+           gen_trace_roi_return().  */
+        if (!marker && (end == MSA_TRACE_ROI_RETURN || ctx->pc != end)) {
+            return false;
+        }
+    }
+
+    ctx->hflags ^= MIPS_HFLAG_TRACE;
+    save_cpu_state(ctx, 0);
+    log_active = !active;
+    if (log_active) {
+        gen_trace_reserve();
+        gen_trace_block_start(ctx->pc);
+    } else {
+        trace_block_end();
+    }
+    if (marker) {
+        log_class = MSA_TRACE_NR_CLASSES;
+    }
+    return marker;
+}
+
 void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
 {
     CPUMIPSState *env = cs->env_ptr;
@@ -21053,6 +21461,15 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
 
     LOG_DISAS("\ntb %p idx %d hflags %04x\n", tb, ctx.mem_idx, ctx.hflags);
     gen_tb_start(tb);
+    log_active = msa_trace_enabled() && (ctx.hflags & MIPS_HFLAG_TRACE);
+    if (log_active) {
+        if (msa_trace_roi_end() == MSA_TRACE_ROI_RETURN &&
+            !(ctx.hflags & MIPS_HFLAG_BMASK)) {
+            gen_trace_roi_return(&ctx);
+        }
+        gen_trace_reserve();
+        gen_trace_block_start(pc_start);
+    }
     while (ctx.bstate == BS_NONE) {
         tcg_gen_insn_start(ctx.pc, ctx.hflags & MIPS_HFLAG_BMASK, ctx.btarget);
         num_insns++;
@@ -21074,7 +21491,13 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
         }
 
         is_slot = ctx.hflags & MIPS_HFLAG_BMASK;
-        if (!(ctx.hflags & MIPS_HFLAG_M16)) {
+        log_pc = ctx.pc;
+        log_class = MSA_TRACE_CLASS_ALU;
+        log_name = NULL;
+        if (msa_trace_enabled() && gen_trace_roi(env, &ctx)) {
+            /* Region marker, otherwise a nop */
+            insn_bytes = 4;
+        } else if (!(ctx.hflags & MIPS_HFLAG_M16)) {
             ctx.opcode = cpu_ldl_code(env, ctx.pc);
             insn_bytes = 4;
             decode_opc(env, &ctx);
@@ -21088,6 +21511,9 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
             generate_exception_end(&ctx, EXCP_RI);
             break;
         }
+        trace_block_insn(insn_bytes == 4 && !(ctx.hflags & MIPS_HFLAG_M16) ?
+                         ctx.opcode : 0,
+                         !is_slot && (ctx.hflags & MIPS_HFLAG_BMASK));
 
         if (ctx.hflags & MIPS_HFLAG_BMASK) {
             if (!(ctx.hflags & (MIPS_HFLAG_BDS16 | MIPS_HFLAG_BDS32 |
@@ -21155,6 +21581,7 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
     }
 done_generating:
     gen_tb_end(tb, num_insns);
+    trace_block_end();
 
     tb->size = ctx.pc - pc_start;
     tb->icount = num_insns;
@@ -21293,6 +21720,9 @@ void mips_tcg_init(void)
     fpu_fcr31 = tcg_global_mem_new_i32(cpu_env,
                                        offsetof(CPUMIPSState, active_fpu.fcr31),
                                        "fcr31");
+    cpu_trace_pos = tcg_global_mem_new_ptr(cpu_env,
+                                           offsetof(CPUMIPSState, trace_pos),
+                                           "trace_pos");
 }
 
 #include "translate_init.c"
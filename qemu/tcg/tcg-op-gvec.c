@@ -0,0 +1,538 @@
+/*
+ * Generic vector operation expansion
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu-common.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "tcg.h"
+#include "tcg-op.h"
+#include "tcg-op-gvec.h"
+
+uint64_t dup_const(unsigned vece, uint64_t c)
+{
+    switch (vece) {
+    case MO_8:
+        return 0x0101010101010101ull * (uint8_t)c;
+    case MO_16:
+        return 0x0001000100010001ull * (uint16_t)c;
+    case MO_32:
+        return 0x0000000100000001ull * (uint32_t)c;
+    case MO_64:
+        return c;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+/*
+ * Add the elements of A and B, with M holding the top bit of every
+ * element.  The top bits are added separately so that no carry crosses
+ * into the next element.
+ */
+static void gen_addv_mask(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b, TCGv_i64 m)
+{
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i64 t2 = tcg_temp_new_i64();
+    TCGv_i64 t3 = tcg_temp_new_i64();
+
+    tcg_gen_andc_i64(t1, a, m);
+    tcg_gen_andc_i64(t2, b, m);
+    tcg_gen_xor_i64(t3, a, b);
+    tcg_gen_add_i64(d, t1, t2);
+    tcg_gen_and_i64(t3, t3, m);
+    tcg_gen_xor_i64(d, d, t3);
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i64(t2);
+    tcg_temp_free_i64(t3);
+}
+
+/* As above for A - B: setting the top bits of A stops every borrow */
+static void gen_subv_mask(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b, TCGv_i64 m)
+{
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i64 t2 = tcg_temp_new_i64();
+    TCGv_i64 t3 = tcg_temp_new_i64();
+
+    tcg_gen_or_i64(t1, a, m);
+    tcg_gen_andc_i64(t2, b, m);
+    tcg_gen_eqv_i64(t3, a, b);
+    tcg_gen_sub_i64(d, t1, t2);
+    tcg_gen_and_i64(t3, t3, m);
+    tcg_gen_xor_i64(d, d, t3);
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i64(t2);
+    tcg_temp_free_i64(t3);
+}
+
+static void gen_vec_mask_i64(void (*gen)(TCGv_i64, TCGv_i64, TCGv_i64,
+                                         TCGv_i64),
+                             unsigned vece, TCGv_i64 d, TCGv_i64 a,
+                             TCGv_i64 b)
+{
+    TCGv_i64 m = tcg_const_i64(dup_const(vece, 1ull << ((8 << vece) - 1)));
+
+    gen(d, a, b, m);
+    tcg_temp_free_i64(m);
+}
+
+void tcg_gen_vec_add8_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_addv_mask, MO_8, d, a, b);
+}
+
+void tcg_gen_vec_add16_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_addv_mask, MO_16, d, a, b);
+}
+
+void tcg_gen_vec_add32_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_addv_mask, MO_32, d, a, b);
+}
+
+void tcg_gen_vec_sub8_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_subv_mask, MO_8, d, a, b);
+}
+
+void tcg_gen_vec_sub16_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_subv_mask, MO_16, d, a, b);
+}
+
+void tcg_gen_vec_sub32_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_vec_mask_i64(gen_subv_mask, MO_32, d, a, b);
+}
+
+/*
+ * Set the top bit of every element of M where A < B.  Where the top bits
+ * of A and B agree, A - B cannot overflow and its sign decides; where
+ * they differ, the one with the top bit clear is the smaller unsigned
+ * and the larger signed value.
+ */
+static void gen_lt_mask(TCGv_i64 m, TCGv_i64 a, TCGv_i64 b, TCGv_i64 top,
+                        bool sign)
+{
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i64 t2 = tcg_temp_new_i64();
+
+    gen_subv_mask(t1, a, b, top);
+    tcg_gen_eqv_i64(t2, a, b);
+    tcg_gen_and_i64(t1, t1, t2);
+    if (sign) {
+        tcg_gen_andc_i64(t2, a, b);
+    } else {
+        tcg_gen_andc_i64(t2, b, a);
+    }
+    tcg_gen_or_i64(m, t1, t2);
+    tcg_gen_and_i64(m, m, top);
+
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i64(t2);
+}
+
+/*
+ * Select the larger (MAX) or smaller element of A and B into D, and the
+ * other one into E if not NULL, which must not alias A or B.  X is
+ * A ^ B where A < B and 0 elsewhere, so A ^ X is the larger element.
+ */
+static void gen_minmax_mask(unsigned vece, TCGv_i64 d, TCGv_i64 e,
+                            TCGv_i64 a, TCGv_i64 b, TCGv_i64 top,
+                            bool sign, bool max)
+{
+    TCGv_i64 x = tcg_temp_new_i64();
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    gen_lt_mask(x, a, b, top, sign);
+    tcg_gen_shri_i64(x, x, (8 << vece) - 1);
+    tcg_gen_muli_i64(x, x, MAKE_64BIT_MASK(0, 8 << vece));
+    tcg_gen_xor_i64(t, a, b);
+    tcg_gen_and_i64(x, x, t);
+    if (e) {
+        tcg_gen_xor_i64(e, max ? b : a, x);
+    }
+    tcg_gen_xor_i64(d, max ? a : b, x);
+
+    tcg_temp_free_i64(x);
+    tcg_temp_free_i64(t);
+}
+
+static GVecGen3Fn * const gvec_add_fns[4] = {
+    tcg_gen_vec_add8_i64, tcg_gen_vec_add16_i64,
+    tcg_gen_vec_add32_i64, tcg_gen_add_i64,
+};
+
+static GVecGen3Fn * const gvec_sub_fns[4] = {
+    tcg_gen_vec_sub8_i64, tcg_gen_vec_sub16_i64,
+    tcg_gen_vec_sub32_i64, tcg_gen_sub_i64,
+};
+
+static void expand_3(GVecGen3Fn *fn, TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b,
+                     unsigned n)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        fn(d[i], a[i], b[i]);
+    }
+}
+
+/* Expand with the constant B in every lane */
+static void expand_3i(GVecGen3Fn *fn, TCGv_i64 *d, TCGv_i64 *a, uint64_t b,
+                      unsigned n)
+{
+    TCGv_i64 t = tcg_const_i64(b);
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        fn(d[i], a[i], t);
+    }
+    tcg_temp_free_i64(t);
+}
+
+void tcg_gen_gvec_mov(TCGv_i64 *d, TCGv_i64 *a, unsigned n)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        tcg_gen_mov_i64(d[i], a[i]);
+    }
+}
+
+void tcg_gen_gvec_dupi(unsigned vece, TCGv_i64 *d, unsigned n, uint64_t c)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        tcg_gen_movi_i64(d[i], dup_const(vece, c));
+    }
+}
+
+void tcg_gen_gvec_add(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n)
+{
+    expand_3(gvec_add_fns[vece], d, a, b, n);
+}
+
+void tcg_gen_gvec_sub(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n)
+{
+    expand_3(gvec_sub_fns[vece], d, a, b, n);
+}
+
+void tcg_gen_gvec_neg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a, unsigned n)
+{
+    TCGv_i64 zero = tcg_const_i64(0);
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        gvec_sub_fns[vece](d[i], zero, a[i]);
+    }
+    tcg_temp_free_i64(zero);
+}
+
+void tcg_gen_gvec_addi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       int64_t c, unsigned n)
+{
+    expand_3i(gvec_add_fns[vece], d, a, dup_const(vece, c), n);
+}
+
+void tcg_gen_gvec_subi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       int64_t c, unsigned n)
+{
+    expand_3i(gvec_sub_fns[vece], d, a, dup_const(vece, c), n);
+}
+
+/* Element-wise operations that need the element size */
+typedef void GVecGen3VFn(unsigned, TCGv_i64, TCGv_i64, TCGv_i64);
+
+static void expand_3v(GVecGen3VFn *fn, unsigned vece, TCGv_i64 *d,
+                      TCGv_i64 *a, TCGv_i64 *b, unsigned n)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        fn(vece, d[i], a[i], b[i]);
+    }
+}
+
+static void expand_3vi(GVecGen3VFn *fn, unsigned vece, TCGv_i64 *d,
+                       TCGv_i64 *a, uint64_t b, unsigned n)
+{
+    TCGv_i64 t = tcg_const_i64(b);
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        fn(vece, d[i], a[i], t);
+    }
+    tcg_temp_free_i64(t);
+}
+
+static TCGv_i64 gen_top_bits(unsigned vece)
+{
+    return tcg_const_i64(dup_const(vece, 1ull << ((8 << vece) - 1)));
+}
+
+/*
+ * The low 8 << VECE bits of a product only depend on the low bits of
+ * the factors: the first element comes out of a full multiply, the
+ * others are shifted down, multiplied and deposited one by one.
+ */
+static void gen_mulv(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    unsigned w = 8 << vece;
+    TCGv_i64 r, t1, t2;
+    unsigned i;
+
+    if (vece == MO_64) {
+        tcg_gen_mul_i64(d, a, b);
+        return;
+    }
+    r = tcg_temp_new_i64();
+    t1 = tcg_temp_new_i64();
+    t2 = tcg_temp_new_i64();
+    tcg_gen_mul_i64(r, a, b);
+    for (i = w; i < 64; i += w) {
+        tcg_gen_shri_i64(t1, a, i);
+        tcg_gen_shri_i64(t2, b, i);
+        tcg_gen_mul_i64(t1, t1, t2);
+        tcg_gen_deposit_i64(r, r, t1, i, w);
+    }
+    tcg_gen_mov_i64(d, r);
+    tcg_temp_free_i64(r);
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i64(t2);
+}
+
+static void gen_minmax(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b,
+                       bool sign, bool max)
+{
+    TCGv_i64 top = gen_top_bits(vece);
+
+    gen_minmax_mask(vece, d, NULL, a, b, top, sign, max);
+    tcg_temp_free_i64(top);
+}
+
+static void gen_smax(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_minmax(vece, d, a, b, true, true);
+}
+
+static void gen_umax(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_minmax(vece, d, a, b, false, true);
+}
+
+static void gen_smin(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_minmax(vece, d, a, b, true, false);
+}
+
+static void gen_umin(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_minmax(vece, d, a, b, false, false);
+}
+
+/* (A & B) + ((A ^ B) >> 1), with the shift done per element */
+static void gen_avg(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b,
+                    bool sign)
+{
+    TCGv_i64 top = gen_top_bits(vece);
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    TCGv_i64 t2 = tcg_temp_new_i64();
+    TCGv_i64 t3 = tcg_temp_new_i64();
+
+    tcg_gen_xor_i64(t1, a, b);
+    tcg_gen_and_i64(t2, a, b);
+    tcg_gen_shri_i64(t3, t1, 1);
+    tcg_gen_andc_i64(t3, t3, top);
+    if (sign) {
+        /* arithmetic shift: keep the sign bit of every element */
+        tcg_gen_and_i64(t1, t1, top);
+        tcg_gen_or_i64(t3, t3, t1);
+    }
+    gen_addv_mask(d, t2, t3, top);
+
+    tcg_temp_free_i64(top);
+    tcg_temp_free_i64(t1);
+    tcg_temp_free_i64(t2);
+    tcg_temp_free_i64(t3);
+}
+
+static void gen_savg(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_avg(vece, d, a, b, true);
+}
+
+static void gen_uavg(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_avg(vece, d, a, b, false);
+}
+
+/* max(A, B) - min(A, B) */
+static void gen_absdiff(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b,
+                        bool sign)
+{
+    TCGv_i64 top = gen_top_bits(vece);
+    TCGv_i64 hi = tcg_temp_new_i64();
+    TCGv_i64 lo = tcg_temp_new_i64();
+
+    gen_minmax_mask(vece, hi, lo, a, b, top, sign, true);
+    gen_subv_mask(d, hi, lo, top);
+
+    tcg_temp_free_i64(top);
+    tcg_temp_free_i64(hi);
+    tcg_temp_free_i64(lo);
+}
+
+static void gen_sabsdiff(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_absdiff(vece, d, a, b, true);
+}
+
+static void gen_uabsdiff(unsigned vece, TCGv_i64 d, TCGv_i64 a, TCGv_i64 b)
+{
+    gen_absdiff(vece, d, a, b, false);
+}
+
+void tcg_gen_gvec_mul(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_mulv, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_smax(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_smax, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_umax(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_umax, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_smin(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_smin, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_umin(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_umin, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_smaxi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n)
+{
+    expand_3vi(gen_smax, vece, d, a, dup_const(vece, c), n);
+}
+
+void tcg_gen_gvec_umaxi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n)
+{
+    expand_3vi(gen_umax, vece, d, a, dup_const(vece, c), n);
+}
+
+void tcg_gen_gvec_smini(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n)
+{
+    expand_3vi(gen_smin, vece, d, a, dup_const(vece, c), n);
+}
+
+void tcg_gen_gvec_umini(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n)
+{
+    expand_3vi(gen_umin, vece, d, a, dup_const(vece, c), n);
+}
+
+void tcg_gen_gvec_savg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_savg, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_uavg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_uavg, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_sabsdiff(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                           TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_sabsdiff, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_uabsdiff(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                           TCGv_i64 *b, unsigned n)
+{
+    expand_3v(gen_uabsdiff, vece, d, a, b, n);
+}
+
+void tcg_gen_gvec_and(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n)
+{
+    expand_3(tcg_gen_and_i64, d, a, b, n);
+}
+
+void tcg_gen_gvec_or(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n)
+{
+    expand_3(tcg_gen_or_i64, d, a, b, n);
+}
+
+void tcg_gen_gvec_xor(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n)
+{
+    expand_3(tcg_gen_xor_i64, d, a, b, n);
+}
+
+void tcg_gen_gvec_nor(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n)
+{
+    expand_3(tcg_gen_nor_i64, d, a, b, n);
+}
+
+void tcg_gen_gvec_andi(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n)
+{
+    expand_3i(tcg_gen_and_i64, d, a, c, n);
+}
+
+void tcg_gen_gvec_ori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n)
+{
+    expand_3i(tcg_gen_or_i64, d, a, c, n);
+}
+
+void tcg_gen_gvec_xori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n)
+{
+    expand_3i(tcg_gen_xor_i64, d, a, c, n);
+}
+
+void tcg_gen_gvec_nori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n)
+{
+    expand_3i(tcg_gen_nor_i64, d, a, c, n);
+}
+
+void tcg_gen_gvec_bitsel(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b,
+                         TCGv_i64 *c, unsigned n)
+{
+    TCGv_i64 t0 = tcg_temp_new_i64();
+    TCGv_i64 t1 = tcg_temp_new_i64();
+    unsigned i;
+
+    for (i = 0; i < n; i++) {
+        tcg_gen_and_i64(t0, b[i], a[i]);
+        tcg_gen_andc_i64(t1, c[i], a[i]);
+        tcg_gen_or_i64(d[i], t0, t1);
+    }
+    tcg_temp_free_i64(t0);
+    tcg_temp_free_i64(t1);
+}
@@ -0,0 +1,91 @@
+/*
+ * Generic vector operation expansion
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef TCG_TCG_OP_GVEC_H
+#define TCG_TCG_OP_GVEC_H
+
+/*
+ * A guest vector register is an array of N i64 values, least significant
+ * lane first, usually TCG globals.  Elements are MO_8 .. MO_64 wide
+ * (VECE) and never straddle lanes.  TCG has no host vector types, so
+ * every operation is expanded inline into 64-bit integer ops, using
+ * SWAR arithmetic for elements narrower than 64 bits.  The destination
+ * may be the same as any of the sources.
+ */
+
+/* Replicate the low 8 << VECE bits of C over 64 bits */
+uint64_t dup_const(unsigned vece, uint64_t c);
+
+void tcg_gen_gvec_mov(TCGv_i64 *d, TCGv_i64 *a, unsigned n);
+void tcg_gen_gvec_dupi(unsigned vece, TCGv_i64 *d, unsigned n, uint64_t c);
+
+void tcg_gen_gvec_add(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_sub(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_neg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a, unsigned n);
+void tcg_gen_gvec_addi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       int64_t c, unsigned n);
+void tcg_gen_gvec_subi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       int64_t c, unsigned n);
+
+/* Modulo multiply, one multiply per element narrower than 64 bits */
+void tcg_gen_gvec_mul(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                      TCGv_i64 *b, unsigned n);
+
+/* Signed and unsigned maximum and minimum, with A or C */
+void tcg_gen_gvec_smax(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_umax(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_smin(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_umin(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_smaxi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n);
+void tcg_gen_gvec_umaxi(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n);
+void tcg_gen_gvec_smini(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n);
+void tcg_gen_gvec_umini(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                        int64_t c, unsigned n);
+
+/* Average rounded down, (a + b) >> 1 without overflow */
+void tcg_gen_gvec_savg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_uavg(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                       TCGv_i64 *b, unsigned n);
+
+/* Absolute difference |a - b|, as an unsigned element */
+void tcg_gen_gvec_sabsdiff(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                           TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_uabsdiff(unsigned vece, TCGv_i64 *d, TCGv_i64 *a,
+                           TCGv_i64 *b, unsigned n);
+
+void tcg_gen_gvec_and(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_or(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_xor(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_nor(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b, unsigned n);
+void tcg_gen_gvec_andi(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n);
+void tcg_gen_gvec_ori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n);
+void tcg_gen_gvec_xori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n);
+void tcg_gen_gvec_nori(TCGv_i64 *d, TCGv_i64 *a, uint64_t c, unsigned n);
+
+/* d = (b & a) | (c & ~a) */
+void tcg_gen_gvec_bitsel(TCGv_i64 *d, TCGv_i64 *a, TCGv_i64 *b,
+                         TCGv_i64 *c, unsigned n);
+
+/* 64-bit building blocks: packed 8, 16 or 32-bit elements in an i64 */
+void tcg_gen_vec_add8_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+void tcg_gen_vec_add16_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+void tcg_gen_vec_add32_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+void tcg_gen_vec_sub8_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+void tcg_gen_vec_sub16_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+void tcg_gen_vec_sub32_i64(TCGv_i64 d, TCGv_i64 a, TCGv_i64 b);
+
+#endif
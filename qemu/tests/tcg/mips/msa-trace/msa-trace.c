@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <msa.h>
+
+/*
+ * MSA loads and stores, plus LDI and SLD, whose names contain "LD" but
+ * which do not access memory: the trace must classify them by flags.
+ */
+static int buf[256] __attribute__((aligned(16)));
+
+int main()
+{
+    v4i32 acc = __builtin_msa_ldi_w(0);
+    v16i8 rot = (v16i8)__builtin_msa_ldi_b(1);
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        buf[i] = i;
+    }
+    for (i = 0; i < 256; i += 4) {
+        v4i32 v = __builtin_msa_ld_w(&buf[i], 0);
+
+        acc = __builtin_msa_addv_w(acc, v);
+        rot = __builtin_msa_sld_b(rot, (v16i8)v, 0);
+        __builtin_msa_st_w(acc, &buf[i], 0);
+    }
+    printf("%d %d\n", buf[252], __builtin_msa_copy_s_b(rot, 0));
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdint.h>
+
+/* Enough distinct blocks and loops for the cache to hold real code */
+static uint32_t crc32(const uint8_t *p, int len)
+{
+    uint32_t crc = 0xffffffff;
+    int i, j;
+
+    for (i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+int main()
+{
+    uint8_t buf[4096];
+    uint32_t crc = 0;
+    int i, n;
+
+    for (n = 0; n < 16; n++) {
+        for (i = 0; i < sizeof(buf); i++) {
+            buf[i] = i * n + (crc >> (i & 31));
+        }
+        crc = crc32(buf, sizeof(buf));
+        printf("%2d %08x\n", n, crc);
+    }
+
+    return 0;
+}
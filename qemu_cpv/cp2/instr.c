@@ -16,10 +16,17 @@ static char float32_is_nan(unsigned int a) {
 }
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 int float_flag_denorm = 64;
 
-float_status f_status;
+// softfloat status of the current machine
+#define f_status         (kern.fstatus)
+#define f_status_ctrl_rm (kern.fstatus_ctrl_rm)
+
+// for k128cp2elfun
+float_status *k128cp2_float_status () {
+	return &f_status;
+}
 
 // instruction emulation
 #define instr_def(instr_name) void execute_instr_##instr_name (instr_t instr)
@@ -2671,7 +2678,7 @@ void execute_instr_RSQRT(instr_t instr) {
 void instdump (instr_t instr) {
 
 	// string for instdump
-	static char str[400];
+	static __thread char str[400];
 
 	if(!kern.nulify)
 		sprintf(str,"instdump:");
@@ -2722,6 +2729,7 @@ void update_softfloat_rounding_mode () {
 	ctrl_rm = ctrl_rm & REG_CONTROL_RM;
 
 	// update softfloat rounding mode
+	f_status_ctrl_rm = ctrl_rm;
 	switch (ctrl_rm) {
 		case REG_CONTROL_RM_RN : f_status.float_rounding_mode = float_round_nearest_even; break;
 		case REG_CONTROL_RM_RZ : f_status.float_rounding_mode = float_round_to_zero     ; break;
@@ -2741,8 +2749,10 @@ void softfloat_prepare () {
 	// clear softfloat exception bits
 	f_status.float_exception_flags = 0;
 
-	// set rounding mode from control register
-	update_softfloat_rounding_mode ();
+	// set rounding mode from control register if it was changed
+	if ((rawread_ctrlreg (CTRLREG_CONTROL) & REG_CONTROL_RM) != f_status_ctrl_rm) {
+		update_softfloat_rounding_mode ();
+	}
 }
 
 
@@ -2756,29 +2766,20 @@ void softfloat_clear () {
 
 
 //
-void execute_instr_vliw (instr_t instr) {
-
-	// instdump support
-	if (k128cp2_machine -> opt_dump_inst) {
-		instdump(instr);
-	}
-
-	// execute instrs
-	execute_instr_hi (instr);
-	execute_instr_lo (instr);
-
+static void execute_instr_hi_unknown (instr_t instr) {
+	sim_error ("unknown opcode 0x%02x",(int)instr_opcode(instr));
 }
 
-
 //
-void execute_instr_hi      (instr_t instr) {
+static void execute_instr_lo_unknown (instr_t instr) {
+	sim_error ("unknown opcode2 0x%02x",(int)instr_opcode2(instr));
+}
 
-	// prepare softfloat
-	softfloat_prepare ();
 
-//#define case_code(instr_name)  case INSTR_OPCODE_##instr_name:  execute_instr_##instr_name(instr); break;
+// decode calculation part of instruction
+static instr_handler_t decode_instr_hi (instr_t instr) {
+
 #define case_code(instr_name)  case INSTR_OPCODE_##instr_name:
-	// decode & execute instruction
 	switch (instr_opcode(instr)) {
 		case_code(NOP);
 		case_code(CMADD);
@@ -2867,23 +2868,18 @@ void execute_instr_hi      (instr_t instr) {
 		case_code(CHMSUB);
 		case_code(QSDOT);
 		case_code(UNPCK16WSTOPS);
-		execute_instr_CAL_COMMON(instr); break;
-		default: sim_error ("unknown opcode 0x%02x",(int)instr_opcode(instr)); break;
+			return execute_instr_CAL_COMMON;
+		default:
+			return execute_instr_hi_unknown;
 	};
 #undef case_code
-
-	// clear softfloat
-	softfloat_clear ();
-
 }
 
 
-//
-void execute_instr_lo      (instr_t instr) {
+// decode control/memory part of instruction
+static instr_handler_t decode_instr_lo (instr_t instr) {
 
-#define case_code(instr_name)  case INSTR_OPCODE2_##instr_name:  execute_instr_##instr_name(instr); break;
-//#define case_code(instr_name)  case INSTR_OPCODE2_##instr_name:
-	// decode & execute instruction
+#define case_code(instr_name)  case INSTR_OPCODE2_##instr_name:  return execute_instr_##instr_name;
 	switch (instr_opcode2(instr)) {
 		case_code(RUN);
 		case_code(RUNI);
@@ -2927,11 +2923,79 @@ void execute_instr_lo      (instr_t instr) {
 		case INSTR_OPCODE2_UPDADDR    :
 		case INSTR_OPCODE2_UPDADDRNP  :
 		case INSTR_OPCODE2_UPDADDRNM  :
-			execute_instr_LMEM_COMMON(instr);
-			break;
-		default: sim_error ("unknown opcode2 0x%02x",(int)instr_opcode2(instr)); break;
+			return execute_instr_LMEM_COMMON;
+		default:
+			return execute_instr_lo_unknown;
 	};
 #undef case_code
+}
+
+
+// decode vliw instruction into handlers of both parts
+void decode_instr_vliw (instr_t instr, decoded_instr_t *d) {
+
+	d->instr       = instr;
+	d->hi          = decode_instr_hi (instr);
+	d->lo          = decode_instr_lo (instr);
+	d->lmem_params = NULL;
+	if (d->lo == execute_instr_LMEM_COMMON) {
+		d->lmem_params = lmem_get_instr_params (instr);
+	}
+	d->valid       = TRUE;
+}
+
+
+//
+void execute_decoded_vliw (const decoded_instr_t *d) {
+
+	// instdump support
+	if (k128cp2_machine -> opt_dump_inst) {
+		instdump(d->instr);
+	}
+
+	// execute instrs
+	softfloat_prepare ();
+	d->hi (d->instr);
+	softfloat_clear ();
+
+	if (d->lmem_params != NULL) {
+		lmem_pipe_new_entry_params (d->instr, d->lmem_params);
+	} else {
+		d->lo (d->instr);
+	}
+}
+
+
+//
+void execute_instr_vliw (instr_t instr) {
+
+	decoded_instr_t d;
+
+	decode_instr_vliw (instr, &d);
+	execute_decoded_vliw (&d);
+}
+
+
+//
+void execute_instr_hi      (instr_t instr) {
+
+	// prepare softfloat
+	softfloat_prepare ();
+
+	// decode & execute instruction
+	decode_instr_hi (instr) (instr);
+
+	// clear softfloat
+	softfloat_clear ();
+
+}
+
+
+//
+void execute_instr_lo      (instr_t instr) {
+
+	// decode & execute instruction
+	decode_instr_lo (instr) (instr);
 
 }
 
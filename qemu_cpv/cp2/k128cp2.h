@@ -58,6 +58,16 @@ void     libk128cp2_reset      (void *cp2ptr);
 
 void     libk128cp2_clock      (void *cp2ptr, uint64_t k64clock);
 
+// Причина возврата из libk128cp2_run.
+typedef enum {
+	K128CP2_STOP_BUDGET, // max_cycles executed
+	K128CP2_STOP_IDLE,   // stopped, fifo empty and pipelines drained
+	K128CP2_STOP_HALT,   // left run mode
+	K128CP2_STOP_DMA     // start_dma pending
+} k128cp2_stop_reason_t;
+
+uint64_t libk128cp2_run        (void *cp2ptr, uint64_t k64clock, uint64_t max_cycles, int *stop_reason);
+
 uint64_t libk128cp2_reg_read   (void *cp2ptr, int regno);
 void     libk128cp2_reg_write  (void *cp2ptr, int regno, uint64_t value, uint64_t mask, int ldc2flag);
 
@@ -76,6 +86,7 @@ uint64_t libk128cp2_ireg_read (void *cp2ptr, int regno);
 /* Required for QEMU */
 void     libk128cp2_print(void *cp2ptr, const char *str);
 int      libk128cp2_pending_work(void *cp2ptr);
+int      libk128cp2_idle(void *cp2ptr);
 
 // ==========  End of API Functions Declarations  ==========
 
@@ -3,7 +3,9 @@
 #include "local.h"
 #include "softfloat.h"
 
-extern float_status f_status;
+// softfloat status of the current machine
+float_status *k128cp2_float_status ();
+#define f_status (*k128cp2_float_status ())
 
 //
 float k128cp2elfun_common (k128cp2elfun_params_t *func_params, float x) {
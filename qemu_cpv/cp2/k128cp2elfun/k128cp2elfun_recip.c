@@ -12,7 +12,9 @@
 #include "local.h"
 #include "softfloat.h"
 
-extern float_status f_status;
+// softfloat status of the current machine
+float_status *k128cp2_float_status ();
+#define f_status (*k128cp2_float_status ())
 
 // Elementary function calculation: 1/x (recip)
 
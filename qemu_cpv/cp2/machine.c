@@ -22,8 +22,9 @@
 #include "k128cp2_resetstate.xmlc"
 
 
-// global machine pointer
-Machine_T *k128cp2_machine = NULL;
+// machine the current API call works on
+// (thread local: different threads may drive different machines at once)
+__thread Machine_T *k128cp2_machine = NULL;
 
 // set/release global pointer to cp2 structure
 #define SET_GLOBAL_POINTER     \
@@ -50,7 +51,7 @@ int     libk128cp2_create (void **cp2ptrptr) {
 	#endif
 
 	*cp2ptrptr = NULL;
-	*cp2ptrptr = (void*) malloc(sizeof(Machine_T));
+	*cp2ptrptr = (void*) calloc(1, sizeof(Machine_T));
 	if (*cp2ptrptr != NULL) {
 		return 0;
 	} else {
@@ -118,6 +119,9 @@ int libk128cp2_init (void *cp2ptr) {
 	// flush save state counter
 	mch -> savestate_counter = 0;
 
+	// per machine options table
+	options_init ();
+
 	// init observer
 	observer_init ();
 
@@ -233,6 +237,36 @@ void libk128cp2_load_options (void *cp2ptr, char *config_filename) {
 
 
 
+// nothing left to clock: the kernel is stopped, the fifo is drained
+// and no instruction is still in flight in the pipelines
+static int machine_idle (void) {
+	return !kern.run_flag && prockern_k64fifo_empty() &&
+		!kern.sync_pending && !kern.stop_pending &&
+		kern.delayed_reg_write_queue_numentries == 0 &&
+		kern.lmem_pipe_numentries == 0 &&
+		kern.cal_pipe_numentries == 0;
+}
+
+// one clock of the kernel, global pointer must be set
+static inline void machine_clock (uint64_t k64clock) {
+
+	// notify observer
+	if (k128cp2_machine -> observer_enabled) {
+		observer_step_start (reg_clockcount);
+	}
+
+	// kernel step
+	prockern_do_one_step (k64clock);
+
+	// notify observer
+	if (k128cp2_machine -> observer_enabled) {
+		observer_step_finish (reg_clockcount);
+	}
+
+	// increment clock count
+	reg_clockcount += 1;
+}
+
 //
 /*!
  * \brief
@@ -249,19 +283,68 @@ void libk128cp2_clock (void *cp2ptr, uint64_t k64clock) {
 	sim_printf ("%s (cp2ptr=%p, k64clock=%lld)", __FUNCTION__, cp2ptr, (uint64_t) k64clock);
 	#endif
 
-	// notify observer
-	observer_step_start (reg_clockcount);
+	machine_clock (k64clock);
 
-	// kernel step
-	prockern_do_one_step (k64clock);
+	RELEASE_GLOBAL_POINTER;
+}
 
-	// notify observer
-	observer_step_finish (reg_clockcount);
 
-	// increment clock count
-	reg_clockcount += 1;
+// Clocks the kernel up to max_cycles times in a row
+/*!
+ * \brief
+ * \param  *cp2ptr
+ * \param  k64clock     k64 clock of the first cycle, incremented every cycle
+ * \param  max_cycles   cycle budget
+ * \param  *stop_reason why the loop returned (k128cp2_stop_reason_t)
+ * \return       Number of cycles executed.
+ *
+ * Returns early once the kernel has nothing left to execute, when it
+ * leaves run mode or when it raises a DMA request, which must be served
+ * (libk128cp2_start_dma_read) before clocking on.
+ */
+uint64_t libk128cp2_run (void *cp2ptr, uint64_t k64clock, uint64_t max_cycles, int *stop_reason) {
+
+	uint64_t n;
+	int      reason = K128CP2_STOP_BUDGET;
+	int      was_running;
+
+	SET_GLOBAL_POINTER;
+
+	// debug message
+	#if ((LIBK128CP2_DEBUG_PRINT_API_CALLS > 0) && (LIBK128CP2_DEBUG_PRINT_API_CALLS_CLOCK > 0))
+	sim_printf ("%s (cp2ptr=%p, k64clock=%lld, max_cycles=%lld)", __FUNCTION__, cp2ptr, (uint64_t) k64clock, (uint64_t) max_cycles);
+	#endif
+
+	for (n = 0; n < max_cycles; n++) {
+
+		was_running = kern.run_flag;
+
+		machine_clock (k64clock + n);
+
+		if (kern.start_dma) {
+			reason = K128CP2_STOP_DMA;
+			n++;
+			break;
+		}
+		if (was_running && !kern.run_flag) {
+			reason = K128CP2_STOP_HALT;
+			n++;
+			break;
+		}
+		if (machine_idle ()) {
+			reason = K128CP2_STOP_IDLE;
+			n++;
+			break;
+		}
+	}
+
+	if (stop_reason != NULL) {
+		*stop_reason = reason;
+	}
 
 	RELEASE_GLOBAL_POINTER;
+
+	return n;
 }
 
 
@@ -643,6 +726,19 @@ int libk128cp2_pending_work  (void *cp2ptr) {
     return retval;
 }
 
+/* Nothing left to clock and no DMA request to serve */
+int libk128cp2_idle  (void *cp2ptr) {
+    int retval;
+
+    SET_GLOBAL_POINTER;
+
+    retval = machine_idle() && !kern.start_dma;
+
+    RELEASE_GLOBAL_POINTER;
+
+    return retval;
+}
+
 //
 /*!
  * \brief
@@ -1061,6 +1157,9 @@ int machine_finalize () {
 		fclose (mch -> outstream);
 	}
 
+	// free option strings
+	options_finalize ();
+
 	// return
 	return 0;
 }
@@ -20,6 +20,12 @@ typedef struct {
 	// processor kernel
 	ProcKern_T prockern;
 
+	// observer state
+	observer_state_t observer;
+
+	// options table (values loaded for this machine)
+	option_t options[OPTIONS_NUM];
+
 	// output stream
 	FILE *outstream;
 
@@ -60,11 +66,17 @@ typedef struct {
 	int   opt_savestate_message     ;
 	char *opt_savestate_fileprefix  ;
 
+	// set when any per-clock observer dump is enabled
+	int   observer_enabled          ;
+
 // savestate counter
 	int savestate_counter;
 
 } Machine_T;
 
+// machine the current API call works on
+extern __thread Machine_T *k128cp2_machine;
+
 
 // Functions
 void print_word64                 (uint64_t data, unsigned output_type);
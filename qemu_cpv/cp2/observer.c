@@ -6,23 +6,12 @@
 #include "options.h"
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 
-// cycle counter
-uint64_t step_number;
-
-// events buffer
-// 2D buffer
-// 1st dimension: time shift
-//   events_buffer_start = current time
-// 2nd dimension: different events
-#define EVENTS_BUFFER_TIMEDEPTH     20
-#define EVENTS_BUFFER_EVENTS_MAXNUM 100
-struct {
-	event_t events[EVENTS_BUFFER_EVENTS_MAXNUM];
-	int events_num;
-} events_buffer[EVENTS_BUFFER_TIMEDEPTH];
-int events_buffer_start;
+// observer state of the current machine
+#define step_number         (k128cp2_machine->observer.step_number)
+#define events_buffer       (k128cp2_machine->observer.events_buffer)
+#define events_buffer_start (k128cp2_machine->observer.events_buffer_start)
 
 
 //
@@ -64,6 +53,11 @@ void send_newevent (
 
 	event_t ev;
 
+	// events are only collected to be dumped
+	if (!k128cp2_machine -> opt_dump_event_enable) {
+		return;
+	}
+
 	// fill observer interface structure
 	ev.clck  = clck;
 	ev.src   = src;
@@ -228,15 +222,15 @@ char* event_src_str(event_src_t src) {
 void eventsbuffer_dump_event (event_t *event_ptr) {
 
 	uint32_t datahi,datalo;
-	static char str[200]      ;
-	static char idstr[100]    ;
-	static char clckstr[100]  ;
-	static char sectstr[100]  ;
-	static char srcstr[100]   ;
-	static char typestr[100]  ;
-	static char addrstr[100]  ;
-	static char valstr[100]   ;
-	static char srck64str[100];
+	static __thread char str[200]      ;
+	static __thread char idstr[100]    ;
+	static __thread char clckstr[100]  ;
+	static __thread char sectstr[100]  ;
+	static __thread char srcstr[100]   ;
+	static __thread char typestr[100]  ;
+	static __thread char addrstr[100]  ;
+	static __thread char valstr[100]   ;
+	static __thread char srck64str[100];
 
 	// option dump_event_iram/k64 support
 	if (
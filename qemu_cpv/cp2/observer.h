@@ -59,6 +59,25 @@ typedef struct {
 } event_t;
 
 
+// observer state
+// events buffer: 2D buffer
+// 1st dimension: time shift
+//   events_buffer_start = current time
+// 2nd dimension: different events
+#define EVENTS_BUFFER_TIMEDEPTH     20
+#define EVENTS_BUFFER_EVENTS_MAXNUM 100
+typedef struct {
+	// cycle counter
+	uint64_t step_number;
+
+	struct {
+		event_t events[EVENTS_BUFFER_EVENTS_MAXNUM];
+		int events_num;
+	} events_buffer[EVENTS_BUFFER_TIMEDEPTH];
+	int events_buffer_start;
+} observer_state_t;
+
+
 // function headers
 void observer_newevent    (event_t *eventptr);
 void send_newevent (
@@ -24,10 +24,10 @@
 #define RELEASE_GLOBAL_POINTER k128cp2_machine=NULL;
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 
-//! Options table
-static option_t options_table[] = {
+//! Options defaults, copied into every machine by options_init ()
+static const option_t options_default_table[OPTIONS_NUM] = {
 	{ "dump//inst"              , OPT_TYPE_INT, 0, NULL},
 	{ "dump//inststop"          , OPT_TYPE_INT, 0, NULL},
 	{ "dump//fpu"               , OPT_TYPE_INT, 0, NULL},
@@ -62,6 +62,28 @@ static option_t options_table[] = {
 	{ NULL, 0, 0, NULL}
 };
 
+//! Options table of the current machine
+#define options_table (k128cp2_machine->options)
+
+//! Fill options table of the current machine with defaults
+void options_init ()
+{
+	memcpy (options_table, options_default_table, sizeof(options_default_table));
+}
+
+//! Free option strings of the current machine
+void options_finalize ()
+{
+	int i;
+
+	for (i=0; options_table[i].name != NULL; i++) {
+		if (options_table[i].valstr != NULL) {
+			free (options_table[i].valstr);
+			options_table[i].valstr = NULL;
+		}
+	}
+}
+
 
 void update_options_cache_from_table ();
 
@@ -156,7 +178,7 @@ int load_options_from_xmlfile (char *config_filename)
 void load_options ()
 {
 	int i;
-	static char strval[1000];
+	static __thread char strval[1000];
 
 	// fill options_table
 	i = 0;
@@ -255,6 +277,13 @@ void update_options_cache_from_table ()
 	if (opt_get_value_by_name ("savestate//onstop"       ,  &val)) k128cp2_machine->opt_savestate_onstop      = val.valnum;
 	if (opt_get_value_by_name ("savestate//message"      ,  &val)) k128cp2_machine->opt_savestate_message     = val.valnum;
 	if (opt_get_value_by_name ("savestate//fileprefix"   ,  &val)) k128cp2_machine->opt_savestate_fileprefix  = val.valstr;
+
+	// observer is only needed for per-clock dumps
+	k128cp2_machine->observer_enabled =
+		k128cp2_machine->opt_dump_event_enable ||
+		k128cp2_machine->opt_dump_fpu          ||
+		k128cp2_machine->opt_dump_gpr          ||
+		k128cp2_machine->opt_dump_addrreg;
 }
 
 //! Process options
@@ -17,7 +17,12 @@ typedef struct {
 } option_t;
 
 
+// number of options_table entries (including terminating NULL entry)
+#define OPTIONS_NUM 32
+
 // function headers
+void options_init              ();
+void options_finalize          ();
 void load_options              ();
 int  load_options_from_xmlfile (char *config_filename);
 int  load_options_from_string  (char *str);
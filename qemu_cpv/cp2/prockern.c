@@ -17,7 +17,7 @@
 #define ADDR_LINE_MOD 0x1FFF
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 
 
 //
@@ -98,6 +98,7 @@ void prockern_load_state () {
 
 	// load iram
 	xmldoc_load_iram (kern.iram,IRAM_SIZE,"//state//iram");
+	iram_decoded_invalidate_all ();
 
 	// load data ram
 #if (NUMBER_OF_EXESECT != 4)
@@ -168,9 +169,6 @@ void prockern_save_state (char *state_filename)
 
 	// free xmlwriter
 	xmlFreeTextWriter (xmlwriter);
-
-	// cleanup xml library
-    xmlCleanupParser();
 }
 
 
@@ -378,6 +376,7 @@ bool_t prockern_k64fifo_empty () {
 void prockern_do_one_step (uint64_t k64clock) {
 
 	instr_t next_instr = 0;
+	const decoded_instr_t *next_decoded = NULL;
 	bool_t  start_new_instr, shift_pipes, update_pc;
 	int     ldc2flag = 0;
 
@@ -442,7 +441,7 @@ void prockern_do_one_step (uint64_t k64clock) {
 	} else {
 		// run mode
 		// read next instruction from iram
-		next_instr = get_next_instr_iram ();
+		next_decoded = get_next_decoded_iram ();
 		kern.instr_from_k64fifo = FALSE;
 		start_new_instr = TRUE;
 		shift_pipes     = TRUE;
@@ -454,7 +453,11 @@ do_step1:
 	// start executing new instruction
 	if (start_new_instr) {
 		// execute instruction
-		execute_instr_vliw (next_instr);
+		if (next_decoded != NULL) {
+			execute_decoded_vliw (next_decoded);
+		} else {
+			execute_instr_vliw (next_instr);
+		}
 	}
 
 	// shift pipes
@@ -511,6 +514,35 @@ instr_t get_next_instr_iram () {
 }
 
 
+// same as get_next_instr_iram, decoding the instruction
+// the first time it is fetched from this iram address
+const decoded_instr_t *get_next_decoded_iram () {
+
+	decoded_instr_t *d;
+	uint64_t data64;
+
+	// read 64bit dword from iram (bounds are checked here)
+	data64 = read_iram_ui64 (reg_clockcount, kern.newpc);
+
+	d = &kern.iram_decoded[kern.newpc];
+	if (!d->valid) {
+		decode_instr_vliw (data64, d);
+	}
+
+	return d;
+}
+
+
+// drop all predecoded instructions (iram was rewritten as a whole)
+void iram_decoded_invalidate_all () {
+
+	int i;
+
+	for (i=0; i<IRAM_SIZE/sizeof(uint64_t); i++)
+		kern.iram_decoded[i].valid = FALSE;
+}
+
+
 // store instruction into iram at pc address
 void execute_k64ldc2 (instr_t instr) {
 
@@ -1592,10 +1624,23 @@ void cal_pipe_new_entry (instr_t instr) {
 // add new entry into lmem_pipe
 void lmem_pipe_new_entry (instr_t instr) {
 
+	const lmem_instr_params_t *params;
+
+	// get instruction parameters
+	if ((params = lmem_get_instr_params(instr)) == NULL) {
+		sim_error_internal();
+		return;
+	}
+
+	lmem_pipe_new_entry_params (instr, params);
+}
+
+// add new entry into lmem_pipe, instruction parameters already looked up
+void lmem_pipe_new_entry_params (instr_t instr, const lmem_instr_params_t *params) {
+
 	int rn, pindex;
 	uint32_t addr;
 	addrreg_t offs;
-	const lmem_instr_params_t *params;
 
 	// read instruction fields
 	rn = instr_rn(instr);
@@ -1608,12 +1653,6 @@ void lmem_pipe_new_entry (instr_t instr) {
 	// get pipe index
 	pindex = get_pindex(kern.lmem_pipe_numentries);
 
-	// get instruction parameters
-	if ((params = lmem_get_instr_params(instr)) == NULL) {
-		sim_error_internal();
-		return;
-	}
-
 	if( params->name == 0 ){
     	kern.lmem_pipe[pindex].tkt        = reg_clockcount;
 		kern.lmem_pipe[pindex].stage      = 0; // start
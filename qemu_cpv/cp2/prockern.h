@@ -7,6 +7,7 @@
 #include "common.h"
 #include "observer.h"
 #include "insn_code.h"
+#include "softfloat.h"
 
 // alex add. default value 0
 // If != 0, ignore lc/lsp/la/psp value, use only *_cur
@@ -241,6 +242,16 @@ typedef struct {
 	bool_t nlf;
 } cal_pipe_entry_t;
 
+// predecoded vliw instruction
+typedef void (*instr_handler_t) (instr_t instr);
+typedef struct {
+	instr_t                    instr;
+	instr_handler_t            hi;          // calculation part
+	instr_handler_t            lo;          // control/memory part
+	const lmem_instr_params_t *lmem_params; // set if lo is a lmem operation
+	bool_t                     valid;
+} decoded_instr_t;
+
 // execution section definition
 typedef struct {
 
@@ -408,6 +419,9 @@ typedef struct {
 	// instruction ram
 	uint64_t iram[IRAM_SIZE/sizeof(uint64_t)];
 
+	// predecoded iram, an entry is invalidated when iram is written
+	decoded_instr_t iram_decoded[IRAM_SIZE/sizeof(uint64_t)];
+
 	// execution sections
 	ExeSect_T exesect[NUMBER_OF_EXESECT];
 
@@ -505,6 +519,11 @@ typedef struct {
 	//dma support
 	uint32_t start_dma;
 
+	// softfloat status
+	float_status fstatus;
+	// control register RM bits fstatus rounding mode was set from
+	int          fstatus_ctrl_rm;
+
 }
 ProcKern_T;
 
@@ -519,7 +538,9 @@ int bit_rev(int num, int order);
 uint32_t swap_word  (uint32_t w);
 uint64_t swap_dword (uint64_t w);
 
-void execute_instr_vliw (instr_t instr);
+void execute_instr_vliw   (instr_t instr);
+void decode_instr_vliw    (instr_t instr, decoded_instr_t *d);
+void execute_decoded_vliw (const decoded_instr_t *d);
 
 //
 int  prockern_load_state_from_file   (char *state_filename);
@@ -544,6 +565,8 @@ void     prockern_init               ();
 void     prockern_do_one_step        ();
 void     get_next_instr_from_k64fifo (instr_t *instr, int *ldc2flag);
 instr_t  get_next_instr_iram         ();
+const decoded_instr_t *get_next_decoded_iram ();
+void     iram_decoded_invalidate_all ();
 void     prockern_delta_stage        ();
 void     set_next_pc                 ();
 void     execute_k64ldc2             (instr_t instr);
@@ -579,6 +602,8 @@ void  cal_init               ();
 void  prockern_lmem_newop     (instr_t instr);
 void  prockern_cal_newop     (instr_t instr);
 void  lmem_pipe_new_entry     (instr_t instr);
+void  lmem_pipe_new_entry_params (instr_t instr, const lmem_instr_params_t *params);
+const lmem_instr_params_t* lmem_get_instr_params (instr_t instr);
 void  cal_pipe_new_entry     (instr_t instr);
 void  lmem_pipe_shift         ();
 void  cal_pipe_shift         ();
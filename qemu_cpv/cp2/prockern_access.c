@@ -11,7 +11,7 @@
 #define K128CP2_INITSTATE_FILENAME "k128cp2_initstate.xml"
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 
 // reg read raw
 regval_t reg_read_raw  (regid_t id) {
@@ -438,6 +438,7 @@ void rawwrite_iram_ui64 (cp2addr_t addr, uint64_t data64) {
 		sim_error("trying to write iram at addr=0x%08x",(uint32_t)(addr));
 	} else {
 		iram_ui64 (addr) = data64;
+		kern.iram_decoded[addr].valid = FALSE;
 	}
 }
 
@@ -12,10 +12,10 @@
 
 
 // machine
-extern Machine_T *k128cp2_machine;
+extern __thread Machine_T *k128cp2_machine;
 
 // for parsing xml files
-xmlDocPtr doc;
+__thread xmlDocPtr doc;
 
 
 //
@@ -53,7 +53,7 @@ void sim_print_string (const char *str) {
 //
 void __attribute__((format (printf,1,2)))
 sim_printf (const char fmt[], ...) {
-	static char str[1000];
+	static __thread char str[1000];
 	va_list ap;
 	va_start (ap, fmt);
 	vsnprintf (str, sizeof(str)-1, fmt, ap);
@@ -66,7 +66,7 @@ void __attribute__((noreturn,format (printf,1,2)))
 sim_error (const char fmt[], ...) {
 
 	int l;
-	static char errstr[100];
+	static __thread char errstr[100];
 	va_list ap;
 
 	l = sprintf (errstr, "Error: ");
@@ -84,7 +84,7 @@ void __attribute__((format (printf,1,2)))
 sim_warning (const char fmt[], ...) {
 
 	int l;
-	static char errstr[100];
+	static __thread char errstr[100];
 	va_list ap;
 
 	l = sprintf (errstr, "Warning: ");
@@ -260,9 +260,6 @@ void xmldoc_load_lmem (uint32_t *lmem, int size, char *path) {
 	} else {
 		sim_warning ("tag %s not found", path);
 	}
-
-	// cleanup
-	xmlCleanupParser();
 }
 
 
@@ -286,9 +283,6 @@ void xmldoc_load_iram (uint64_t *iram, int size, char *path) {
 	} else {
 		sim_warning ("tag %s not found", path);
 	}
-
-	// cleanup
-	xmlCleanupParser();
 }
 
 
@@ -296,7 +290,7 @@ void xmldoc_load_iram (uint64_t *iram, int size, char *path) {
 bool_t __attribute__((format (printf,2,3)))
 get_str_tagvalue_from_xmlfile(char* str, const char *pathfmt, ...)
 {
-	static char pathstr[1000];
+	static __thread char pathstr[1000];
 	xmlChar *strval;
 	xmlXPathObjectPtr result;
 	va_list ap;
@@ -319,9 +313,6 @@ get_str_tagvalue_from_xmlfile(char* str, const char *pathfmt, ...)
 		sim_warning ("tag %s not found", pathstr);
 		return FALSE;
 	}
-
-	// cleanup
-	xmlCleanupParser();
 }
 
 
@@ -345,9 +336,6 @@ bool_t get_ui64_tagvalue_from_xmlfile(char *path, uint64_t *data) {
 		sim_warning ("tag %s not found", path);
 		return FALSE;
 	}
-
-	// cleanup
-	xmlCleanupParser();
 }
 
 
@@ -399,9 +387,6 @@ void xmldoc_load_regs () {
 	if (get_ui64_tagvalue_from_xmlfile("//state//lc",      &data)) reg_lc          = data;
 	if (get_ui64_tagvalue_from_xmlfile("//state//la",      &data)) reg_la.ui32     = data;
 	if (get_ui64_tagvalue_from_xmlfile("//state//lsp",     &data)) {reg_lsp        = data; kern.lsp_cur=reg_lsp;}
-
-	//
-	xmlCleanupParser();
 }
 
 
@@ -23,6 +23,7 @@
 #include "sysemu/dma.h"
 #include "qemu/typedefs.h"
 #include "qemu/main-loop.h"
+#include "qemu/rcu.h"
 #include "qemu/log.h"
 #include "hw/mips/cp2.h"
 
@@ -75,6 +76,9 @@
 
 #define DESCR_PROCESSING_TIMEOUT 10000
 
+/* Guest RAM window the channel keeps mapped, see cp2_dma_ram_ptr() */
+#define CP2_DMA_MAP_SIZE         0x10000
+
 enum dma_chstate {
     DMA_IDLE,
     DMA_NODSCR,
@@ -132,8 +136,16 @@ typedef struct CP2DmaState {
     uint16_t cp2_put_addr[4];
 
     AddressSpace *as;
+
+    /* guest RAM window mapped with address_space_map() */
+    uint8_t *map_ptr;
+    hwaddr map_base, map_len;
+    hwaddr map_dirty;           /* end of the stored range, from map_base */
 } CP2DmaState;
 
+/* 13-bit reversed cp2 addresses, see cp2_dma_bitrev() */
+static uint16_t cp2_dma_bitrev_table[0x2000];
+
 static uint64_t cp2_dread(CP2State *cp2, uint8_t n, uint16_t adr);
 static void cp2_dwrite(CP2State *cp2, uint8_t n, uint16_t adr, uint64_t data);
 static uint64_t cp2_ireg_read(CP2State *cp2, uint8_t i);
@@ -187,36 +199,128 @@ static uint64_t swap_dword(uint64_t d)
     return (((uint64_t)wr) << 32) | wl;
 }
 
+static void cp2_dma_unmap(CP2DmaState *s)
+{
+    if (s->map_ptr) {
+        address_space_unmap(s->as, s->map_ptr, s->map_len, s->map_dirty != 0,
+                            s->map_dirty);
+        s->map_ptr = NULL;
+        s->map_dirty = 0;
+    }
+}
+
+static bool cp2_dma_map(CP2DmaState *s, hwaddr base)
+{
+    MemoryRegion *mr;
+    hwaddr xlat, len = CP2_DMA_MAP_SIZE;
+    bool direct;
+
+    /* Bounce buffers would break the masked read-modify-write stores */
+    rcu_read_lock();
+    mr = address_space_translate(s->as, base, &xlat, &len, true);
+    direct = memory_access_is_direct(mr, true);
+    rcu_read_unlock();
+    if (!direct) {
+        return false;
+    }
+
+    s->map_ptr = address_space_map(s->as, base, &len, true);
+    s->map_base = base;
+    s->map_len = len;
+    return s->map_ptr != NULL;
+}
+
+/*
+ * Host pointer to the 8 bytes at guest address ADDR, or NULL when they
+ * are not plain RAM.  The beats of a descriptor mostly land in the same
+ * window, so the address space is only walked again when they leave it.
+ * The window is released by cp2_dma_unmap() once the channel stops.
+ *
+ * Unmapping marks [map_base, map_base + map_dirty) dirty and drops the
+ * TBs there, so a window only becomes dirty on IS_WRITE and the first
+ * store starts a fresh window at its own address: reads dirty nothing
+ * and ascending stores dirty just the range they wrote.
+ */
+static uint8_t *cp2_dma_ram_ptr(CP2DmaState *s, hwaddr addr, bool is_write)
+{
+    hwaddr base = addr & ~(hwaddr)(CP2_DMA_MAP_SIZE - 1);
+    bool first_store = is_write && !s->map_dirty;
+
+    if (first_store) {
+        base = addr;
+    }
+    if (!s->map_ptr || addr < s->map_base ||
+        addr + 8 > s->map_base + s->map_len ||
+        (first_store && addr != s->map_base)) {
+        cp2_dma_unmap(s);
+        if (!cp2_dma_map(s, base) || addr + 8 > s->map_base + s->map_len) {
+            /* the window starts or ends inside a different region */
+            cp2_dma_unmap(s);
+            if (!cp2_dma_map(s, addr) || s->map_len < 8) {
+                cp2_dma_unmap(s);
+                return NULL;
+            }
+        }
+    }
+    if (is_write) {
+        s->map_dirty = MAX(s->map_dirty, addr + 8 - s->map_base);
+    }
+    return s->map_ptr + (addr - s->map_base);
+}
+
 static uint64_t cp2_dma_read64(CP2DmaState *s, uint64_t offset)
 {
+    uint8_t *p = cp2_dma_ram_ptr(s, offset, false);
     uint64_t res;
-    dma_memory_read(s->as, offset, &res, 8);
+
+    if (p) {
+        memcpy(&res, p, 8);
+    } else {
+        dma_memory_read(s->as, offset, &res, 8);
+    }
     return swap_dword(res);
 }
 
 static void cp2_dma_write64(CP2DmaState *s, uint64_t offset,
     uint64_t data, uint64_t mask)
 {
+    uint8_t *p = cp2_dma_ram_ptr(s, offset, true);
     uint64_t val;
 
     data = swap_dword(data);
     mask = swap_dword(mask);
 
+    if (p) {
+        memcpy(&val, p, 8);
+        val = (val & ~mask) | (data & mask);
+        memcpy(p, &val, 8);
+        return;
+    }
+
     dma_memory_read(s->as, offset, &val, 8);
     val = (val & ~mask) | (data & mask);
     dma_memory_write(s->as, offset, &val, 8);
 }
 
-static uint16_t cp2_dma_bitrev(CP2DmaState *s, uint16_t addr)
+static void cp2_dma_bitrev_init(void)
 {
-    uint16_t res = 0;
+    uint16_t addr, res;
     int i;
-    for (i = 0; i < 13; i++) {
-        if (addr & (0x1 << i)) {
-            res |= 0x1 << (13 - i);
+
+    for (addr = 0; addr < ARRAY_SIZE(cp2_dma_bitrev_table); addr++) {
+        res = 0;
+        for (i = 0; i < 13; i++) {
+            if (addr & (0x1 << i)) {
+                res |= 0x1 << (13 - i);
+            }
         }
+        cp2_dma_bitrev_table[addr] = res;
     }
-    return res;
+}
+
+static uint16_t cp2_dma_bitrev(CP2DmaState *s, uint16_t addr)
+{
+    return cp2_dma_bitrev_table[addr & 0x1FFF];
 }
 
 static void cp2_dma_state_idle(CP2DmaState *s)
@@ -620,6 +724,22 @@ static int cp2_dma_state_postsync(CP2DmaState *s)
     return 0;
 }
 
+/* Whether the channel can make progress without help from the kernel */
+static bool cp2_dma_runnable(CP2DmaState *s)
+{
+    switch (s->state) {
+    case DMA_NODSCR:
+    case DMA_WORKING:
+        return true;
+    case DMA_PRESYNC:
+        return !s->d_sync_pre;
+    case DMA_POSTSYNC:
+        return !s->d_sync_post;
+    default:
+        return false;
+    }
+}
+
 static bool cp2_dma_main_action(void *opaque)
 {
     CP2DmaState *s = (CP2DmaState *) opaque;
@@ -663,6 +783,7 @@ static void cp2_dma_write(void *opaque, hwaddr addr,
     CP2DmaState *s = opaque;
     uint32_t data = val;
 
+    cp2_lock(s->cp2);
     if (addr & 0x1000) {  /* system regs */
         switch (addr & 0x001C) {
         case DMA_CREG_ADDRLIM_OFFSET:
@@ -688,6 +809,7 @@ static void cp2_dma_write(void *opaque, hwaddr addr,
             if (s->r_ctrl & 0x1) {
                 MSG_LOG_WRITE("DMA START");
                 cp2_dma_state_idle(s);
+                qemu_event_set(&s->cp2->work_ev);
             }
             break;
         case DMA_CH_CP2_DADDR_OFFSET:
@@ -701,6 +823,7 @@ static void cp2_dma_write(void *opaque, hwaddr addr,
             break;
         }
     }
+    cp2_unlock(s->cp2);
 }
 
 static uint64_t cp2_dma_read(void *opaque, hwaddr addr, unsigned size)
@@ -708,6 +831,7 @@ static uint64_t cp2_dma_read(void *opaque, hwaddr addr, unsigned size)
     CP2DmaState *s = opaque;
     uint64_t rv = 0;  /* return value */
 
+    cp2_lock(s->cp2);
     if (addr & 0x1000) {  /* system regs */
         switch (addr & 0x001C) {
         case DMA_CREG_ADDRLIM_OFFSET:
@@ -754,6 +878,7 @@ static uint64_t cp2_dma_read(void *opaque, hwaddr addr, unsigned size)
             break;
         }
     }
+    cp2_unlock(s->cp2);
 
     return rv;
 }
@@ -772,6 +897,8 @@ static void cp2_dma_reset(DeviceState *dev)
 {
     CP2DmaState *s = CP2_DMA(dev);
 
+    cp2_lock(s->cp2);
+    cp2_dma_unmap(s);
     s->state = DMA_IDLE;
 
     s->r_ctrl = 0;
@@ -785,6 +912,7 @@ static void cp2_dma_reset(DeviceState *dev)
     s->rc_config = 0;
 
     cp2_reset(s->cp2);
+    cp2_unlock(s->cp2);
 }
 
 static int cp2_dma_check_function(struct k128dma_ctrl_state *dma_ctx)
@@ -815,6 +943,7 @@ static int cp2_dma_init(SysBusDevice *sbd)
     memory_region_init_io(&s->iomem[0], OBJECT(s),
                           &dma_mem_ops, s, TYPE_CP2_DMA, CP2_DMA_SIZE);
     sysbus_init_mmio(sbd, &s->iomem[0]);
+    cp2_dma_bitrev_init();
 
     return 0;
 }
@@ -856,19 +985,25 @@ type_init(cp2_dma_register_types)
 #define CTRLREG_RMASK      0x0a
 #define CTRLREG_STOPCODE   0x0b
 
+/* Kernel clocks per CP2 lock hold in the CP2 thread */
+#define CP2_RUN_CYCLES     4096
+
 static void *cp2_thread_fn(void *arg);
 
+void cp2_lock(CP2State *cp2)
+{
+    qemu_mutex_lock(&cp2->lock);
+}
+
+void cp2_unlock(CP2State *cp2)
+{
+    qemu_mutex_unlock(&cp2->lock);
+}
+
+/* Called with the CP2 lock held */
 static void cp2_reset(CP2State *cp2)
 {
-    bool locked = false;
-    if (!qemu_mutex_iothread_locked()) {
-        qemu_mutex_lock_iothread();
-        locked = true;
-    }
     libk128cp2_reset(cp2->cp2ptr);
-    if (locked) {
-        qemu_mutex_unlock_iothread();
-    }
 }
 
 static CP2State *cp2_create(void)
@@ -877,6 +1012,8 @@ static CP2State *cp2_create(void)
 
     cp2 = g_malloc0(sizeof(CP2State));
     memset(cp2, 0, sizeof *cp2);
+    qemu_mutex_init(&cp2->lock);
+    qemu_event_init(&cp2->work_ev, false);
 
     libk128cp2_create(&cp2->cp2ptr);
     libk128cp2_init(cp2->cp2ptr);
@@ -894,33 +1031,79 @@ static inline void cp2_do_one_step(CP2State *cp2)
     libk128cp2_clock(cp2->cp2ptr, cp2->cp2_clock_count++);
 }
 
-void cp2_do_work(CP2State *cp2)
+static void cp2_do_kernel_work(CP2State *cp2)
 {
-    while (1) {
+    do {
         cp2_do_one_step(cp2);
+    } while (libk128cp2_pending_work(cp2->cp2ptr));
+    cp2_do_one_step(cp2);
+}
 
-        if (!libk128cp2_pending_work(cp2->cp2ptr)) {
-            cp2_do_one_step(cp2);
+/* Called with both the BQL and the CP2 lock held */
+static void cp2_do_dma_work(CP2State *cp2)
+{
+    /* Here we try to do several iterations to make DMA faster.
+     * It is required for some CP2 tests under Linux */
+    while (cp2_dma_main_action(cp2->dma_ptr)) {
+        ;
+    }
+    cp2_dma_unmap(cp2->dma_ptr);
+}
 
-            /* Here we try to do several iterations to make DMA faster.
-             * It is required for some CP2 tests under Linux */
-            while (cp2_dma_main_action(cp2->dma_ptr)) {
-                ;
-            }
+void cp2_do_work(CP2State *cp2)
+{
+    cp2_do_kernel_work(cp2);
+    cp2_do_dma_work(cp2);
+}
 
-            break;
-        }
+/* Clocks a running kernel in one batch, called with the CP2 lock held */
+static void cp2_run_kernel(CP2State *cp2, uint64_t max_cycles)
+{
+    int reason;
+
+    cp2->cp2_clock_count += libk128cp2_run(cp2->cp2ptr, cp2->cp2_clock_count,
+                                           max_cycles, &reason);
+    if (reason == K128CP2_STOP_DMA &&
+        libk128cp2_start_dma_read(cp2->cp2ptr)) {
+        cp2_dma_start_channel(cp2->dma_ptr);
     }
 }
 
+/*
+ * The kernel is clocked with the CP2 lock only, so vCPUs keep running
+ * while a CP2 program executes.  The BQL is taken just for the DMA
+ * channel, which reads and writes guest memory.  When neither the kernel
+ * nor the channel has anything to do the thread sleeps on work_ev, which
+ * is set by CP2 register writes and by DMA start.
+ */
 static void *cp2_thread_fn(void *arg)
 {
     CP2State *cp2 = arg;
+    bool dma, idle;
+
+    rcu_register_thread();
 
     while (1) {
-        qemu_mutex_lock_iothread();
-        cp2_do_work(cp2);
-        qemu_mutex_unlock_iothread();
+        qemu_event_reset(&cp2->work_ev);
+
+        cp2_lock(cp2);
+        /* Keep interleaving kernel and DMA closely while the channel
+         * has work, the kernel may be polling it with check_dma. */
+        dma = cp2_dma_runnable(cp2->dma_ptr);
+        cp2_run_kernel(cp2, dma ? 2 : CP2_RUN_CYCLES);
+        dma = cp2_dma_runnable(cp2->dma_ptr);
+        idle = !dma && libk128cp2_idle(cp2->cp2ptr);
+        cp2_unlock(cp2);
+
+        if (dma) {
+            qemu_mutex_lock_iothread();
+            cp2_lock(cp2);
+            cp2_do_dma_work(cp2);
+            cp2_unlock(cp2);
+            qemu_mutex_unlock_iothread();
+        } else if (idle) {
+            qemu_event_wait(&cp2->work_ev);
+        }
     }
     return NULL;
 }
@@ -950,11 +1133,13 @@ bool cp2_fifo_full(CP2State *cp2)
 void cp2_ldc2(CP2State *cp2, uint64_t value)
 {
     libk128cp2_reg_write(cp2->cp2ptr, 0, value, 0xFFFFFFFFFFFFFFFFULL, 1);
+    qemu_event_set(&cp2->work_ev);
 }
 
 void cp2_reg_write(CP2State *cp2, int reg, uint64_t value)
 {
     libk128cp2_reg_write(cp2->cp2ptr, reg, value, 0xFFFFFFFFFFFFFFFFULL, 0);
+    qemu_event_set(&cp2->work_ev);
 }
 
 uint64_t cp2_reg_read(CP2State *cp2, int reg)
@@ -21,30 +21,42 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/main-loop.h"
 #include "hw/hw.h"
 #include "hw/mips/cpudevs.h"
 #include "cpu.h"
 #include "sysemu/kvm.h"
 #include "kvm_mips.h"
 
+/*
+ * Called from devices with the BQL held, and from the CP0 timer code on
+ * the vCPU thread without it.  The Cause bits are updated atomically
+ * because the vCPU may be changing CP0_Cause.TI at the same time.
+ */
 static void cpu_mips_irq_request(void *opaque, int irq, int level)
 {
     MIPSCPU *cpu = opaque;
     CPUMIPSState *env = &cpu->env;
     CPUState *cs = CPU(cpu);
+    bool locked = false;
 
     if (irq < 0 || irq > 7)
         return;
 
+    if (!qemu_mutex_iothread_locked()) {
+        locked = true;
+        qemu_mutex_lock_iothread();
+    }
+
     if (level) {
-        env->CP0_Cause |= 1 << (irq + CP0Ca_IP);
+        atomic_or(&env->CP0_Cause, 1 << (irq + CP0Ca_IP));
 
         if (kvm_enabled() && irq == 2) {
             kvm_mips_set_interrupt(cpu, irq, level);
         }
 
     } else {
-        env->CP0_Cause &= ~(1 << (irq + CP0Ca_IP));
+        atomic_and(&env->CP0_Cause, ~(1 << (irq + CP0Ca_IP)));
 
         if (kvm_enabled() && irq == 2) {
             kvm_mips_set_interrupt(cpu, irq, level);
@@ -56,6 +68,10 @@ static void cpu_mips_irq_request(void *opaque, int irq, int level)
     } else {
         cpu_reset_interrupt(cs, CPU_INTERRUPT_HARD);
     }
+
+    if (locked) {
+        qemu_mutex_unlock_iothread();
+    }
 }
 
 void cpu_mips_irq_init_cpu(MIPSCPU *cpu)
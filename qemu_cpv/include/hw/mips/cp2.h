@@ -12,10 +12,19 @@ typedef struct CP2State {
     void *dma_ptr;
     uint32_t reg31;
     struct QemuThread thread;
+    /* Serializes the CP2 library and the DMA channel state.  The BQL,
+     * when needed, is always taken before it. */
+    QemuMutex lock;
+    /* Set whenever the CP2 thread may have work to do */
+    QemuEvent work_ev;
 } CP2State;
 
 CP2State *sc64_cp2_register(hwaddr addr, AddressSpace *as);
 
+void cp2_lock(CP2State *cp2);
+void cp2_unlock(CP2State *cp2);
+
+/* Called with both the BQL and the CP2 lock held */
 void cp2_do_work(CP2State *cp2);
 
 bool cp2_fifo_full(CP2State *cp2);
@@ -51,25 +51,37 @@ uint32_t cpu_mips_get_random (CPUMIPSState *env)
     return idx;
 }
 
-/* MIPS R4K timer */
-static void cpu_mips_timer_update(CPUMIPSState *env)
+/*
+ * MIPS R4K timer
+ *
+ * Count and Compare are accessed by their vCPU without the BQL, and by
+ * mips_timer_cb() from the main loop.  timer_lock keeps the two from
+ * re-arming the timer with a stale Count or Compare; the interrupt line
+ * is only changed once it has been dropped, as that may take the BQL.
+ */
+static void cpu_mips_timer_update(CPUMIPSState *env, uint32_t skew)
 {
     uint64_t now, next;
     uint32_t wait;
 
     now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
-    wait = env->CP0_Compare - env->CP0_Count - (uint32_t)(now / TIMER_PERIOD);
+    wait = env->CP0_Compare - env->CP0_Count - skew -
+           (uint32_t)(now / TIMER_PERIOD);
     next = now + (uint64_t)wait * TIMER_PERIOD;
     timer_mod(env->timer, next);
 }
 
-/* Expire the timer.  */
-static void cpu_mips_timer_expire(CPUMIPSState *env)
+/* Expire the timer.  Called with timer_lock held.  */
+static void cpu_mips_timer_expire(CPUMIPSState *env, uint32_t skew)
 {
-    cpu_mips_timer_update(env);
+    cpu_mips_timer_update(env, skew);
     if (env->insn_flags & ISA_MIPS32R2) {
-        env->CP0_Cause |= 1 << CP0Ca_TI;
+        atomic_or(&env->CP0_Cause, 1 << CP0Ca_TI);
     }
+}
+
+static void cpu_mips_timer_raise(CPUMIPSState *env)
+{
     qemu_irq_raise(env->irq[(env->CP0_IntCtl >> CP0IntCtl_IPTI) & 0x7]);
 }
 
@@ -79,15 +91,24 @@ uint32_t cpu_mips_get_count (CPUMIPSState *env)
         return env->CP0_Count;
     } else {
         uint64_t now;
+        uint32_t count;
+        bool expired = false;
 
+        qemu_mutex_lock(&env->timer_lock);
         now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
         if (timer_pending(env->timer)
             && timer_expired(env->timer, now)) {
             /* The timer has already expired.  */
-            cpu_mips_timer_expire(env);
+            cpu_mips_timer_expire(env, 0);
+            expired = true;
         }
+        count = env->CP0_Count + (uint32_t)(now / TIMER_PERIOD);
+        qemu_mutex_unlock(&env->timer_lock);
 
-        return env->CP0_Count + (uint32_t)(now / TIMER_PERIOD);
+        if (expired) {
+            cpu_mips_timer_raise(env);
+        }
+        return count;
     }
 }
 
@@ -101,21 +122,25 @@ void cpu_mips_store_count (CPUMIPSState *env, uint32_t count)
     if (env->CP0_Cause & (1 << CP0Ca_DC) || !env->timer)
         env->CP0_Count = count;
     else {
+        qemu_mutex_lock(&env->timer_lock);
         /* Store new count register */
         env->CP0_Count = count -
                (uint32_t)(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) / TIMER_PERIOD);
         /* Update timer timer */
-        cpu_mips_timer_update(env);
+        cpu_mips_timer_update(env, 0);
+        qemu_mutex_unlock(&env->timer_lock);
     }
 }
 
 void cpu_mips_store_compare (CPUMIPSState *env, uint32_t value)
 {
+    qemu_mutex_lock(&env->timer_lock);
     env->CP0_Compare = value;
     if (!(env->CP0_Cause & (1 << CP0Ca_DC)))
-        cpu_mips_timer_update(env);
+        cpu_mips_timer_update(env, 0);
     if (env->insn_flags & ISA_MIPS32R2)
-        env->CP0_Cause &= ~(1 << CP0Ca_TI);
+        atomic_and(&env->CP0_Cause, ~(1 << CP0Ca_TI));
+    qemu_mutex_unlock(&env->timer_lock);
     qemu_irq_lower(env->irq[(env->CP0_IntCtl >> CP0IntCtl_IPTI) & 0x7]);
 }
 
@@ -126,9 +151,11 @@ void cpu_mips_start_count(CPUMIPSState *env)
 
 void cpu_mips_stop_count(CPUMIPSState *env)
 {
+    qemu_mutex_lock(&env->timer_lock);
     /* Store the current value */
     env->CP0_Count += (uint32_t)(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) /
                                  TIMER_PERIOD);
+    qemu_mutex_unlock(&env->timer_lock);
 }
 
 static void mips_timer_cb (void *opaque)
@@ -146,15 +173,18 @@ static void mips_timer_cb (void *opaque)
     /* ??? This callback should occur when the counter is exactly equal to
        the comparator value.  Offset the count by one to avoid immediately
        retriggering the callback before any virtual time has passed.  */
-    env->CP0_Count++;
-    cpu_mips_timer_expire(env);
-    env->CP0_Count--;
+    qemu_mutex_lock(&env->timer_lock);
+    cpu_mips_timer_expire(env, 1);
+    qemu_mutex_unlock(&env->timer_lock);
+    cpu_mips_timer_raise(env);
 }
 
 void cpu_mips_clock_init (MIPSCPU *cpu)
 {
     CPUMIPSState *env = &cpu->env;
 
+    qemu_mutex_init(&env->timer_lock);
+
     /*
      * If we're in KVM mode, don't create the periodic timer, that is handled in
      * kernel.
@@ -40,6 +40,7 @@ void helper_cp2_mtc2(CPUMIPSState *env, uint32_t opcode, uint32_t dtmc,
     CP2State *cp2 = env->cp2;
 
     qemu_mutex_lock_iothread();
+    cp2_lock(cp2);
 
     cp2_do_work(cp2);
 
@@ -68,6 +69,7 @@ void helper_cp2_mtc2(CPUMIPSState *env, uint32_t opcode, uint32_t dtmc,
      * because they check RUN flag immediately after mtc2 execution. */
     cp2_do_work(cp2);
 
+    cp2_unlock(cp2);
     qemu_mutex_unlock_iothread();
 }
 
@@ -80,6 +82,7 @@ void helper_cp2_mfc2(CPUMIPSState *env, uint32_t opcode, uint32_t dmfc,
     const uint64_t iram_size = (64 * 1024) / sizeof(uint64_t); /* in qwords */
 
     qemu_mutex_lock_iothread();
+    cp2_lock(cp2);
 
     cp2_do_work(cp2);
 
@@ -114,6 +117,7 @@ void helper_cp2_mfc2(CPUMIPSState *env, uint32_t opcode, uint32_t dmfc,
     env->active_tc.gpr[rt_num] = data;
 
     MSG_LOG_WRITE("mfc2 rt=%d, rd=%d, data=%lx", rt_num, rd_num, data);
+    cp2_unlock(cp2);
     qemu_mutex_unlock_iothread();
 }
 
@@ -129,6 +133,7 @@ void helper_cp2_ldc2(CPUMIPSState *env, uint32_t opcode, uint64_t value,
     }
 
     qemu_mutex_lock_iothread();
+    cp2_lock(cp2);
 
     cp2_do_work(cp2);
 
@@ -147,6 +152,7 @@ void helper_cp2_ldc2(CPUMIPSState *env, uint32_t opcode, uint64_t value,
     }
 
     MSG_LOG_WRITE("ldc2 rt=%d, value=%lx", rt_num, value);
+    cp2_unlock(cp2);
     qemu_mutex_unlock_iothread();
 }
 
@@ -157,6 +163,7 @@ target_ulong helper_cp2_bc2(CPUMIPSState *env, uint32_t opcode)
     bool c;
 
     qemu_mutex_lock_iothread();
+    cp2_lock(cp2);
 
     cp2_do_work(cp2);
 
@@ -168,6 +175,7 @@ target_ulong helper_cp2_bc2(CPUMIPSState *env, uint32_t opcode)
     }
 
     MSG_LOG_WRITE("bc2");
+    cp2_unlock(cp2);
     qemu_mutex_unlock_iothread();
 
     return c;
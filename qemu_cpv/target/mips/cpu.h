@@ -5,6 +5,9 @@
 
 #define CPUArchState struct CPUMIPSState
 
+/* MIPS processors have a weak memory model, ordered by SYNC */
+#define TCG_GUEST_DEFAULT_MO      (0)
+
 #include "qemu-common.h"
 #include "cpu-qom.h"
 #include "mips-defs.h"
@@ -498,10 +501,9 @@ struct CPUMIPSState {
     uint64_t CP0_MAAR[MIPS_MAAR_MAX];
     int32_t CP0_MAARI;
     /* XXX: Maybe make LLAddr per-TC? */
-    uint64_t lladdr;
+    uint64_t CP0_LLAddr;    /* physical address of the last LL */
+    uint64_t lladdr;        /* virtual address, checked by SC */
     target_ulong llval;
-    target_ulong llnewval;
-    target_ulong llreg;
     uint64_t CP0_LLAddr_rw_bitmask;
     int CP0_LLAddr_shift;
     target_ulong CP0_WatchLo[8];
@@ -626,6 +628,7 @@ struct CPUMIPSState {
     const mips_def_t *cpu_model;
     void *irq[8];
     QEMUTimer *timer; /* Internal timer */
+    QemuMutex timer_lock; /* Count/Compare against the timer callback */
     MemoryRegion *itc_tag; /* ITC Configuration Tags */
     target_ulong exception_base; /* ExceptionBase input to the core */
 };
@@ -745,7 +748,7 @@ enum {
 
     EXCP_LAST = EXCP_TLBRI,
 };
-/* Dummy exception for conditional stores.  */
+/* Exceptions from here on are internal to QEMU.  */
 #define EXCP_SC 0x100
 
 /*
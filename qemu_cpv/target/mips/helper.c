@@ -413,7 +413,7 @@ void cpu_mips_store_status(CPUMIPSState *env, target_ulong val)
 void cpu_mips_store_cause(CPUMIPSState *env, target_ulong val)
 {
     uint32_t mask = 0x00C00300;
-    uint32_t old = env->CP0_Cause;
+    int32_t old, new;
     int i;
 
     if (env->insn_flags & ISA_MIPS32R2) {
@@ -423,10 +423,17 @@ void cpu_mips_store_cause(CPUMIPSState *env, target_ulong val)
         mask &= ~((1 << CP0Ca_WP) & val);
     }
 
-    env->CP0_Cause = (env->CP0_Cause & ~mask) | (val & mask);
+    /*
+     * Devices and the timer set IP/TI concurrently without the BQL held
+     * here, so only replace the writable bits and keep theirs.
+     */
+    do {
+        old = atomic_read(&env->CP0_Cause);
+        new = (old & ~mask) | (val & mask);
+    } while (atomic_cmpxchg(&env->CP0_Cause, old, new) != old);
 
-    if ((old ^ env->CP0_Cause) & (1 << CP0Ca_DC)) {
-        if (env->CP0_Cause & (1 << CP0Ca_DC)) {
+    if ((old ^ new) & (1 << CP0Ca_DC)) {
+        if (new & (1 << CP0Ca_DC)) {
             cpu_mips_stop_count(env);
         } else {
             cpu_mips_start_count(env);
@@ -435,8 +442,8 @@ void cpu_mips_store_cause(CPUMIPSState *env, target_ulong val)
 
     /* Set/reset software interrupts */
     for (i = 0 ; i < 2 ; i++) {
-        if ((old ^ env->CP0_Cause) & (1 << (CP0Ca_IP + i))) {
-            cpu_mips_soft_irq(env, i, env->CP0_Cause & (1 << (CP0Ca_IP + i)));
+        if ((old ^ new) & (1 << (CP0Ca_IP + i))) {
+            cpu_mips_soft_irq(env, i, new & (1 << (CP0Ca_IP + i)));
         }
     }
 }
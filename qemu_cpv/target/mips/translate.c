@@ -2112,45 +2112,47 @@ OP_LD_ATOMIC(lld,ld64);
 #endif
 #undef OP_LD_ATOMIC
 
-#ifdef CONFIG_USER_ONLY
-#define OP_ST_ATOMIC(insn,fname,ldname,almask)                               \
+/*
+ * LL records the virtual address and the loaded value; SC succeeds if
+ * the address matches and memory still holds that value, checked and
+ * stored with one host compare-and-swap.  This keeps SC atomic between
+ * vCPUs under MTTCG and between guest threads in linux-user, without
+ * an exclusive section.  Any SC clears the link.  ARG1 and ARG2 must be
+ * local temps.
+ */
+#define OP_ST_ATOMIC(insn,fname,ldname,almask,memop)                         \
 static inline void op_st_##insn(TCGv arg1, TCGv arg2, int rt, int mem_idx,   \
                                 DisasContext *ctx)                           \
 {                                                                            \
-    TCGv t0 = tcg_temp_new();                                                \
+    TCGv t0 = tcg_temp_local_new();                                          \
+    TCGv t1 = tcg_temp_new();                                                \
     TCGLabel *l1 = gen_new_label();                                          \
     TCGLabel *l2 = gen_new_label();                                          \
+    TCGLabel *l3 = gen_new_label();                                          \
                                                                              \
     tcg_gen_andi_tl(t0, arg2, almask);                                       \
     tcg_gen_brcondi_tl(TCG_COND_EQ, t0, 0, l1);                              \
-    tcg_gen_st_tl(arg2, cpu_env, offsetof(CPUMIPSState, CP0_BadVAddr));          \
+    tcg_gen_st_tl(arg2, cpu_env, offsetof(CPUMIPSState, CP0_BadVAddr));      \
     generate_exception(ctx, EXCP_AdES);                                      \
     gen_set_label(l1);                                                       \
-    tcg_gen_ld_tl(t0, cpu_env, offsetof(CPUMIPSState, lladdr));                  \
-    tcg_gen_brcond_tl(TCG_COND_NE, arg2, t0, l2);                            \
-    tcg_gen_movi_tl(t0, rt | ((almask << 3) & 0x20));                        \
-    tcg_gen_st_tl(t0, cpu_env, offsetof(CPUMIPSState, llreg));                   \
-    tcg_gen_st_tl(arg1, cpu_env, offsetof(CPUMIPSState, llnewval));              \
-    generate_exception_end(ctx, EXCP_SC);                                    \
-    gen_set_label(l2);                                                       \
+    tcg_gen_ld_tl(t0, cpu_env, offsetof(CPUMIPSState, lladdr));              \
+    tcg_gen_brcond_tl(TCG_COND_EQ, arg2, t0, l2);                            \
     tcg_gen_movi_tl(t0, 0);                                                  \
+    tcg_gen_br(l3);                                                          \
+    gen_set_label(l2);                                                       \
+    tcg_gen_ld_tl(t1, cpu_env, offsetof(CPUMIPSState, llval));               \
+    tcg_gen_atomic_cmpxchg_tl(t0, arg2, t1, arg1, mem_idx, memop);           \
+    tcg_gen_setcond_tl(TCG_COND_EQ, t0, t0, t1);                             \
+    gen_set_label(l3);                                                       \
+    tcg_gen_movi_tl(t1, -1);                                                 \
+    tcg_gen_st_tl(t1, cpu_env, offsetof(CPUMIPSState, lladdr));              \
     gen_store_gpr(t0, rt);                                                   \
+    tcg_temp_free(t1);                                                       \
     tcg_temp_free(t0);                                                       \
 }
-#else
-#define OP_ST_ATOMIC(insn,fname,ldname,almask)                               \
-static inline void op_st_##insn(TCGv arg1, TCGv arg2, int rt, int mem_idx,   \
-                                DisasContext *ctx)                           \
-{                                                                            \
-    TCGv t0 = tcg_temp_new();                                                \
-    gen_helper_1e2i(insn, t0, arg1, arg2, mem_idx);                          \
-    gen_store_gpr(t0, rt);                                                   \
-    tcg_temp_free(t0);                                                       \
-}
-#endif
-OP_ST_ATOMIC(sc,st32,ld32s,0x3);
+OP_ST_ATOMIC(sc,st32,ld32s,0x3,MO_TESL);
 #if defined(TARGET_MIPS64)
-OP_ST_ATOMIC(scd,st64,ld64,0x7);
+OP_ST_ATOMIC(scd,st64,ld64,0x7,MO_TEQ);
 #endif
 #undef OP_ST_ATOMIC
 
@@ -2446,13 +2448,8 @@ static void gen_st_cond (DisasContext *ctx, uint32_t opc, int rt,
     TCGv t0, t1;
     int mem_idx = ctx->mem_idx;
 
-#ifdef CONFIG_USER_ONLY
     t0 = tcg_temp_local_new();
     t1 = tcg_temp_local_new();
-#else
-    t0 = tcg_temp_new();
-    t1 = tcg_temp_new();
-#endif
     gen_base_offset_addr(ctx, t0, base, offset);
     gen_load_gpr(t1, rt);
     switch (opc) {
@@ -4952,7 +4949,7 @@ static void gen_mfhc0(DisasContext *ctx, TCGv arg, int reg, int sel)
     case 17:
         switch (sel) {
         case 0:
-            gen_mfhc0_load64(arg, offsetof(CPUMIPSState, lladdr),
+            gen_mfhc0_load64(arg, offsetof(CPUMIPSState, CP0_LLAddr),
                              ctx->CP0_LLAddr_shift);
             rn = "LLAddr";
             break;
@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+# Parallel compiler flag sweep.
+#
+# Every line of profiling/parameters.txt is a set of compiler keys.  Each
+# (key set, algorithm, source file) is one job: compile the source with
+# the keys, run it under qemu-mips64el -cpu I6400 with the MSA trace on,
+# and compute the metrics.  Jobs run on all cores from a work queue, each
+# in its own scratch directory with its own a.out and trace file, so they
+# never step on each other.  Binaries are cached by a hash of the
+# compiler, the keys and the sources, so re-running a sweep only compiles
+# what changed.
+#
+# Results are merged into the layout run.sh produced:
+#
+#   profiling/<counter>/key.txt
+#   profiling/<counter>/<alg>_log_msa
+#   profiling/<counter>/<alg>_metrics/{main_cnt,msa_metric,...}
+#
+# As with run.sh, when an algorithm has several source files, the merged
+# log and metrics are those of the last one in directory order.
+import argparse
+import concurrent.futures
+import hashlib
+import os
+import re
+import shutil
+import subprocess
+import sys
+import threading
+
+# dirs with algorithms
+PATHS = [
+    'CAVLC',
+    'CABAC',
+    # 'ConvolutionMatrix',
+    # 'MotionCompensation',  # не работает
+    'MotionEstimation',
+    'FDCT-IDCT',
+    # 'Quantization',
+]
+
+CC = 'mips-img-linux-gnu-gcc-6.3.0'
+CXX = 'mips-img-linux-gnu-g++'
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+SOURCE_RE = re.compile(r'\.[c,p]{1,3}$')
+HEADER_RE = re.compile(r'\.(h|hpp)$')
+
+
+class Job:
+    def __init__(self, counter, keys, alg, source):
+        self.counter = counter
+        self.keys = keys
+        self.alg = alg
+        self.source = source
+        self.name = '%d/%s/%s' % (counter, alg, source)
+
+
+def compiler_for(source):
+    return CXX if source.endswith('.cpp') else CC
+
+
+def binary_hash(job):
+    """Hash of everything the binary depends on."""
+    alg_dir = os.path.join(ROOT, job.alg)
+    h = hashlib.sha1()
+    h.update(compiler_for(job.source).encode() + b'\0')
+    h.update(job.keys.encode() + b'\0')
+    for name in sorted(os.listdir(alg_dir)):
+        if name == job.source or HEADER_RE.search(name):
+            h.update(name.encode() + b'\0')
+            with open(os.path.join(alg_dir, name), 'rb') as f:
+                h.update(f.read())
+    return h.hexdigest()
+
+
+class Sweep:
+    def __init__(self, args):
+        self.args = args
+        self.profiling = os.path.join(ROOT, 'profiling')
+        self.cache = os.path.join(self.profiling, '.cache')
+        self.scratch = os.path.join(self.profiling, '.scratch')
+        self.build_locks = {}
+        self.lock = threading.Lock()
+
+    def build(self, job, log):
+        """Return the cached binary for job, compiling it if needed."""
+        key = binary_hash(job)
+        with self.lock:
+            build_lock = self.build_locks.setdefault(key, threading.Lock())
+        binary = os.path.join(self.cache, key, 'a.out')
+        with build_lock:
+            if os.path.exists(binary):
+                return binary
+            tmp_dir = os.path.join(self.cache, key + '.tmp')
+            os.makedirs(tmp_dir, exist_ok=True)
+            cmd = ([compiler_for(job.source)] + job.keys.split() +
+                   [os.path.join(ROOT, job.alg, job.source),
+                    '-o', os.path.join(tmp_dir, 'a.out')])
+            subprocess.run(cmd, check=True, stdout=log, stderr=log)
+            os.replace(tmp_dir, os.path.join(self.cache, key))
+        return binary
+
+    def run(self, job):
+        work = os.path.join(self.scratch, job.name)
+        shutil.rmtree(work, ignore_errors=True)
+        os.makedirs(work)
+        log_name = '%s_log_msa' % job.alg
+        metrics = os.path.join(work, '%s_metrics' % job.alg)
+        os.mkdir(metrics)
+
+        # The programs open their inputs relative to the algorithm dir;
+        # copy them so that outputs never overwrite the originals
+        alg_dir = os.path.join(ROOT, job.alg)
+        for name in os.listdir(alg_dir):
+            src = os.path.join(alg_dir, name)
+            if name == 'main_cnt':
+                shutil.copy(src, metrics)
+            elif os.path.isdir(src):
+                shutil.copytree(src, os.path.join(work, name))
+            elif not SOURCE_RE.search(name):
+                shutil.copy(src, work)
+
+        with open(os.path.join(work, 'job.log'), 'w') as log:
+            binary = self.build(job, log)
+            subprocess.run([self.args.qemu, '-cpu', 'I6400',
+                            '-msa-trace', log_name, binary],
+                           cwd=work, check=True,
+                           stdout=subprocess.DEVNULL, stderr=log)
+            if os.access(self.args.metrics_tool, os.X_OK):
+                cmd = [self.args.metrics_tool]
+            else:
+                cmd = [sys.executable,
+                       os.path.join(ROOT, 'Python_parser', 'parser_v2.py')]
+            subprocess.run(cmd + [log_name, '.', '%s_metrics' % job.alg],
+                           cwd=work, check=True, stdout=log, stderr=log)
+        return work
+
+    def merge(self, job, work):
+        out = os.path.join(self.profiling, str(job.counter))
+        with self.lock:
+            os.makedirs(out, exist_ok=True)
+            with open(os.path.join(out, 'key.txt'), 'w') as f:
+                f.write(job.keys + '\n')
+            log_name = '%s_log_msa' % job.alg
+            metrics = '%s_metrics' % job.alg
+            os.replace(os.path.join(work, log_name),
+                       os.path.join(out, log_name))
+            shutil.rmtree(os.path.join(out, metrics), ignore_errors=True)
+            shutil.move(os.path.join(work, metrics),
+                        os.path.join(out, metrics))
+        if not self.args.keep_scratch:
+            shutil.rmtree(work, ignore_errors=True)
+
+    def jobs(self):
+        with open(self.args.params) as f:
+            key_sets = [line.rstrip('\n') for line in f]
+        for counter, keys in enumerate(key_sets, self.args.first_counter):
+            if not keys.strip():
+                continue
+            for alg in self.args.algorithms:
+                sources = sorted(name for name in os.listdir(os.path.join(ROOT, alg))
+                                 if SOURCE_RE.search(name))
+                for source in sources:
+                    yield Job(counter, keys, alg, source)
+
+    def main(self):
+        jobs = list(self.jobs())
+        # The last source file of an algorithm wins, as in run.sh
+        final = {}
+        for job in jobs:
+            final[(job.counter, job.alg)] = job
+
+        failed = 0
+        with concurrent.futures.ThreadPoolExecutor(self.args.jobs) as pool:
+            futures = {pool.submit(self.run, job): job for job in jobs}
+            for future in concurrent.futures.as_completed(futures):
+                job = futures[future]
+                try:
+                    work = future.result()
+                except (OSError, subprocess.CalledProcessError) as e:
+                    failed += 1
+                    print('%s: failed: %s' % (job.name, e))
+                    continue
+                if final[(job.counter, job.alg)] is job:
+                    self.merge(job, work)
+                elif not self.args.keep_scratch:
+                    shutil.rmtree(work, ignore_errors=True)
+                print('%s: done' % job.name)
+        print('%d jobs, %d failed' % (len(jobs), failed))
+        return 1 if failed else 0
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Run the compiler flag sweep in parallel.')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help='parallel jobs (default: number of cores)')
+    parser.add_argument('--params',
+                        default=os.path.join(ROOT, 'profiling', 'parameters.txt'),
+                        help='file with one set of compiler keys per line')
+    parser.add_argument('--first-counter', type=int, default=26,
+                        help='profiling/<counter> of the first key set')
+    parser.add_argument('--algorithms', nargs='+', default=PATHS)
+    parser.add_argument('--qemu',
+                        default=os.path.join(ROOT, 'qemu', 'mips64el-linux-user',
+                                             'qemu-mips64el'))
+    parser.add_argument('--metrics-tool',
+                        default=os.path.join(ROOT, 'qemu', 'msa-metrics'),
+                        help='parser_v2.py is used if it is not built')
+    parser.add_argument('--keep-scratch', action='store_true',
+                        help='keep per-job scratch dirs in profiling/.scratch')
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    sys.exit(Sweep(parse_args()).main())